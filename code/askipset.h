@@ -5,6 +5,11 @@
 #include <random>
 #include <vector>
 #include <unordered_set>
+#include <cstring>
+#include <ctime>
+#include <cassert>
+
+#include "slab_allocator.h"
 
 namespace sss { // sss is simple skip set or single-threaded skip set
 
@@ -18,6 +23,11 @@ private:
     // NOTE: we will allocate memory in place after value for contigoous layout, 
     // check create_node() & destroy_node()
     Node* next[1];   
+
+    // the bytes of the node with the tower, for SlabAllocator
+    static std::size_t size_of(const int height) {
+      return sizeof(Node) + (height-1)*sizeof(Node*);
+    }
   };
 
   class Iterator {
@@ -46,23 +56,18 @@ private:
   };
 
 public:
-  ASkipSet() : head_(nullptr), height_(0), count_(0), modify_count_(0), threshold_(0), ascope_(0), search_index_(-1LL) {
+  ASkipSet() : head_(nullptr), height_(0), count_(0), modify_count_(0), threshold_(0), ascope_(0), search_index_(-1LL),
+               slab_(kMaxHeight) {
     head_ = create_node(kMaxHeight, T());
     std::srand(std::time(0));
     search_keys_ = std::vector<T>(kSearchKeySize);
   }
 
+  // the memory of all nodes including head_ is freed by slab_, so only destroy the keys
   ~ASkipSet() noexcept {
-    auto* node = head_->next[0];
-    while (node)
-    {
-      auto* to_destroy = node;
-      node = node->next[0];
-      destroy_node(to_destroy);
+    for (auto* node = head_; node; node = node->next[0]) {
+      node->key.~T();
     }
-    // NOTE: destory head without calling destroy_node is for debug purpose
-    head_->key.~T();
-    std::free(head_);
   }
 
   ASkipSet(const ASkipSet&) = delete;
@@ -190,16 +195,18 @@ private:
     if (!(find && find->key == key))
       return false;
 
-    // can be eraaed
+    // can be eraaed, the levels unlinked are the height of the node
+    int find_height = 0;
     for (int level = 0; level < height_; level++) {
       if (preds[level]->next[level] != find)
         break;
       preds[level]->next[level] = find->next[level];
+      ++find_height;
     }
     while (height_ > 0 && head_->next[height_-1] == nullptr)
       --height_;
 
-    destroy_node(find);
+    destroy_node(find, find_height);
 
     return true;  
   }
@@ -212,7 +219,7 @@ private:
   Node* create_node(const int height, T&& new_key)  const {
     assert(height > 0 && height <= kMaxHeight);
 
-    void* node_mem = std::malloc(sizeof(Node)+(height-1)*sizeof(Node*));
+    void* node_mem = slab_.allocate(height);
     assert(node_mem);
     
     Node* new_node = static_cast<Node*>(node_mem);
@@ -226,11 +233,11 @@ private:
     return new_node;
   }
 
-  void destroy_node(Node* node) const noexcept {
+  void destroy_node(Node* node, const int height) const noexcept {
     assert(node != head_);    // avoid wrong destroy head_, head_ will be freed in dtor()
     
     node->key.~T();
-    std::free(node);
+    slab_.deallocate(node, height);
   }
 
   int random_height() const {
@@ -306,6 +313,8 @@ private:
       bool erase_res = erase_internal(key);
       assert(erase_res);
     }
+    // the freed blocks are in the order of the old random addresses, reuse them from the low address up
+    slab_.sort_free_lists();
 
     for (const auto& key : all_keys) {
       bool insert_res = insert_internal(key);
@@ -328,6 +337,9 @@ private:
   const int kMaxHeight = 32;
   const float kProbability = 0.5;
   const int kSearchKeySize = 64;
+
+  // NOTE: after kMaxHeight which initializes it, and mutable because create_node() is const
+  mutable SlabAllocator<Node> slab_;
 };
 
 
@@ -6,6 +6,7 @@
 
 #include <atomic>
 #include <cassert>
+#include <cstdint>
 #include <tuple>
 
 namespace sss {
@@ -67,6 +68,11 @@ public:
   }
 
   // Absolutely setters
+  // NOTE: set() is not atomic for the read-modify-write, it is only for a node which no other thread can see
+  void set(T* const ref, const bool flag, std::memory_order order = std::memory_order_seq_cst) noexcept {
+    combine_.store(combine(ref, flag), order);
+  }
+
   void set_flag(const bool flag, std::memory_order order = std::memory_order_seq_cst) noexcept {
     if (flag) {
       combine_.fetch_or(kLastBitMask, order);
@@ -0,0 +1,96 @@
+// tail latency of the lock-free containers under hot-key contention with different contention managers
+// check contention_manager.h
+//   g++ -std=c++17 -O2 -pthread bench_contention.cc -o bench_contention
+//
+// All threads add() and remove() a few hot keys, so nearly every CAS races with others on the same nodes.
+// The latency of each operation is recorded, and the percentiles of all threads are reported.
+
+#include <iostream>
+#include <random>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+#include "lock_free_skip_set.h"
+#include "lock_free_set_link_list.h"
+
+template <class Set>
+void hot_key_one_thread_f(const int seed, const int ops, const int hot_keys, Set& set, std::vector<int64_t>& latencies) {
+  std::mt19937 g(seed);
+  latencies.reserve(ops);
+  for (int i = 0; i < ops; ++i) {
+    const int num = g() % hot_keys;
+    const auto start_time = std::chrono::steady_clock::now();
+    if (g() % 2 == 0) {
+      set.add(num);
+    } else {
+      set.remove(num);
+    }
+    latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_time).count());
+
+    if (i % 64 == 0)
+      set.quiescent();
+  }
+  set.offline();
+}
+
+template <class Set>
+void bench_hot_key(const char* name, const int thread_num, const int hot_keys, const int ops) {
+  Set set;
+  // some cold keys so the hot keys are not the whole set
+  for (int i = hot_keys; i < hot_keys + 1024; ++i) {
+    set.add(i);
+  }
+
+  std::vector<std::vector<int64_t>> latencies(thread_num);
+  std::vector<std::thread> threads;
+  const auto start_time = std::chrono::steady_clock::now();
+  for (int i = 0; i < thread_num; ++i) {
+    threads.push_back(std::thread(hot_key_one_thread_f<Set>, i, ops, hot_keys, std::ref(set), std::ref(latencies[i])));
+  }
+  for (auto& th : threads) {
+    th.join();
+  }
+  const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time);
+
+  std::vector<int64_t> all;
+  for (const auto& lats : latencies) {
+    all.insert(all.end(), lats.begin(), lats.end());
+  }
+  std::sort(all.begin(), all.end());
+  const auto percentile = [&all](const double p) { return all[static_cast<size_t>(p * (all.size()-1))]; };
+
+  const double mops = static_cast<double>(thread_num) * ops / 1000 / (duration.count() + 1);
+  std::cout << name << ", thread nums = " << thread_num << ", hot keys = " << hot_keys;
+  std::cout << ", Mops/s = " << mops << ", p50(ns) = " << percentile(0.5) << ", p99(ns) = " << percentile(0.99);
+  std::cout << ", p99.9(ns) = " << percentile(0.999) << ", max(ns) = " << all.back() << '\n';
+}
+
+void bench_lfss() {
+  constexpr int hot_keys = 4;
+  constexpr int ops = 1 << 18;
+  for (const int thread_num : {4, 16, 64}) {
+    bench_hot_key<sss::LockFreeSkipSet<int, sss::EpochReclaimer, sss::NoBackoff>>("LockFreeSkipSet NoBackoff", thread_num, hot_keys, ops);
+    bench_hot_key<sss::LockFreeSkipSet<int, sss::EpochReclaimer, sss::ExponentialBackoff>>("LockFreeSkipSet ExponentialBackoff", thread_num, hot_keys, ops);
+    bench_hot_key<sss::LockFreeSkipSet<int, sss::EpochReclaimer, sss::PauseSpin>>("LockFreeSkipSet PauseSpin", thread_num, hot_keys, ops);
+  }
+}
+
+void bench_lfsll() {
+  constexpr int hot_keys = 4;
+  constexpr int ops = 1 << 18;
+  for (const int thread_num : {4, 16, 64}) {
+    bench_hot_key<sss::LockFreeSetLinkList<int, sss::HazardPointerDomain, sss::NoBackoff>>("LockFreeSetLinkList NoBackoff", thread_num, hot_keys, ops);
+    bench_hot_key<sss::LockFreeSetLinkList<int, sss::HazardPointerDomain, sss::ExponentialBackoff>>("LockFreeSetLinkList ExponentialBackoff", thread_num, hot_keys, ops);
+    bench_hot_key<sss::LockFreeSetLinkList<int, sss::HazardPointerDomain, sss::PauseSpin>>("LockFreeSetLinkList PauseSpin", thread_num, hot_keys, ops);
+  }
+}
+
+int main() {
+  bench_lfss();
+
+  bench_lfsll();
+
+  return 0;
+}
@@ -0,0 +1,88 @@
+#include <cassert>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <iostream>
+
+#include "lock_free_double_link_list.h"
+
+// search from head_ is what a singly linked list can do, e.g. LockFreeSetLinkList,
+// the previous key is the last key less than the current one, so each step of a reverse scan is O(n)
+template <class List>
+int prev_key_from_head(List& list, const int key) {
+  int prev = -1;
+  for (auto c = list.first(); c.valid() && *c < key; ++c) {
+    prev = *c;
+  }
+  return prev;
+}
+
+// scan all keys in descending order
+void bench_reverse_scan() {
+  for (const int n : {1 << 10, 1 << 12, 1 << 14}) {
+    sss::LockFreeDoubleLinkList<int> lfdll;
+    for (int i = 0; i < n; ++i)
+      lfdll.add(i);
+
+    auto start_time = std::chrono::steady_clock::now();
+    long long sum_cursor = 0;
+    for (auto c = lfdll.last(); c.valid(); --c) {
+      sum_cursor += *c;
+    }
+    const auto cursor_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time).count();
+
+    start_time = std::chrono::steady_clock::now();
+    long long sum_head = 0;
+    for (int key = prev_key_from_head(lfdll, n); key >= 0; key = prev_key_from_head(lfdll, key)) {
+      sum_head += key;
+    }
+    const auto head_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time).count();
+    assert(sum_cursor == sum_head);
+
+    std::cout << "bench_reverse_scan, keys = " << n << ", cursor(us) = " << cursor_us;
+    std::cout << ", search from head(us) = " << head_us << '\n';
+  }
+}
+
+// the list has the even keys, insert an odd key after each even key, then erase them.
+// By cursors, each edit is next to the cursor. By keys, each edit searches from head_
+void bench_local_edit() {
+  for (const int n : {1 << 10, 1 << 12, 1 << 14}) {
+    sss::LockFreeDoubleLinkList<int> by_cursor;
+    sss::LockFreeDoubleLinkList<int> by_key;
+    for (int i = 0; i < n; ++i) {
+      by_cursor.add(i*2);
+      by_key.add(i*2);
+    }
+
+    auto start_time = std::chrono::steady_clock::now();
+    for (auto c = by_cursor.first(); c.valid(); ++c) {
+      by_cursor.insert_after(c, *c + 1);
+    }
+    for (auto c = by_cursor.first(); c.valid(); ++c) {
+      by_cursor.erase(c);   // c moves to the odd one
+    }
+    const auto cursor_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time).count();
+
+    start_time = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; ++i) {
+      by_key.add(i*2 + 1);
+    }
+    for (int i = 0; i < n; ++i) {
+      by_key.remove(i*2);
+    }
+    const auto key_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time).count();
+    assert(by_cursor.size() == n && by_key.size() == n);
+
+    std::cout << "bench_local_edit, keys = " << n << ", edits = " << n*2 << ", by cursor(us) = " << cursor_us;
+    std::cout << ", by key from head(us) = " << key_us << '\n';
+  }
+}
+
+int main() {
+  bench_reverse_scan();
+
+  bench_local_edit();
+
+  return 0;
+}
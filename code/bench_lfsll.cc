@@ -0,0 +1,71 @@
+#include <cassert>
+#include <random>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <iostream>
+
+#include <sys/resource.h>
+
+#include "lock_free_set_link_list.h"
+
+// NOTE: ru_maxrss is in KB for Linux but in bytes for MacOS.
+// It is the peak RSS, so if it does not grow round by round, RSS stays flat
+long peak_rss() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+template <class Reclaimer>
+void churn_one_thread_f(const int seed, const int ops, const int bound, 
+                        sss::LockFreeSetLinkList<int, Reclaimer>& lfsll) {
+  std::mt19937 g(seed);
+  for (int i = 0; i < ops; ++i) {
+    const int num = g() % bound;
+    if (i % 2 == 0) {
+      lfsll.add(num);
+    } else {
+      lfsll.remove(num);
+    }
+
+    if (i % 64 == 0)
+      lfsll.quiescent();
+  }
+  lfsll.offline();
+}
+
+// threads keep adding and removing keys in a small scope,
+// so the set size is stable but millions of nodes are unlinked.
+// Before hazard pointers, all unlinked nodes were kept in a gc queue until dtor(), so RSS grew every round.
+// Check it with LeakReclaimer which has the same behaviour.
+template <class Reclaimer>
+void bench_churn_rss(const char* name, const int thread_num, const int bound, const int ops, const int rounds) {
+  sss::LockFreeSetLinkList<int, Reclaimer> lfsll;
+
+  for (int r = 0; r < rounds; ++r) {
+    std::vector<std::thread> threads;
+    const auto start_time = std::chrono::steady_clock::now();
+    for (int i = 0; i < thread_num; ++i) {
+      threads.push_back(std::thread(churn_one_thread_f<Reclaimer>, r*thread_num+i, ops, bound, std::ref(lfsll)));
+    }
+    for (auto& th : threads) {
+      th.join();
+    }
+    const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time);
+    std::cout << "bench_churn_rss for " << name << ", round " << r << ", thread nums = " << thread_num << ", ops per thread = " << ops;
+    std::cout << ", size = " << lfsll.size() << ", duration(ms) = " << duration.count();
+    std::cout << ", peak rss = " << peak_rss() << '\n';
+  }
+}
+
+int main() {
+  bench_churn_rss<sss::HazardPointerDomain>("HazardPointerDomain", 8, 1<<10, 1<<20, 10);
+
+  // bench_churn_rss<sss::QsbrReclaimer>("QsbrReclaimer", 8, 1<<10, 1<<20, 10);
+
+  // NOTE: run it alone, because peak rss can only grow
+  // bench_churn_rss<sss::LeakReclaimer>("LeakReclaimer", 8, 1<<10, 1<<20, 10);
+
+  return 0;
+}
@@ -4,11 +4,23 @@
 #include <thread>
 #include <chrono>
 
+#include <queue>
+#include <mutex>
+#include <functional>
+
+#include <sys/resource.h>
+
 #include "lock_free_skip_set.h"
+#include "prefix_string.h"
 #include "skipset.h"
 #include "skipset.cc"
 #include "vectskipset.h"
 #include "vectskipset.cc"
+#include "sharded_skip_set.h"
+#include "flat_combining_skip_set.h"
+#include "delegation_server.h"
+#include "lazy_skip_set.h"
+#include "swmr_skip_set.h"
 
 std::vector<int> random_nums(const int bound) {
   std::vector<int> nums(bound);
@@ -63,6 +75,13 @@ void bench_add_random_multi_threads(const int thread_num, const int bound) {
   std::cout << ", duration(us) = " << duration.count() << '\n';
 }
 
+// insert throughput should scale with threads, not serialize on the global allocator
+void bench_add_scale(const int bound) {
+  for (const int thread_num : {1, 2, 4, 8, 16, 32}) {
+    bench_add_random_multi_threads(thread_num, bound);
+  }
+}
+
 void bench_add_random_by_one_skipset(const int bound) {
   const auto nums = random_nums(bound);
   sss::SkipSet<int> ss;
@@ -114,11 +133,84 @@ void bench_add_random_by_multi_skipset(const int ss_num, const int bound) {
   std::cout << "bench_add_random_by_multi_skipset, " << ss_num << " threads each with one SkipSet, duration (us) = " << duration.count() << '\n';
 }
 
+// sorted keys by add() one by one vs. add_batch(), e.g. ingesting sorted batches into a set which has data
+void bench_add_sorted_batch(const int bound, const int batch_size) {
+  std::vector<int> existing;
+  for (int i = 0; i < bound; i += 2)
+    existing.push_back(i);
+
+  sss::LockFreeSkipSet<int> by_add;
+  sss::LockFreeSkipSet<int> by_batch;
+  by_add.add_batch(existing.begin(), existing.end());
+  by_batch.add_batch(existing.begin(), existing.end());
+
+  std::vector<int> batch;
+  for (int i = 1; i < bound; i += 2)
+    batch.push_back(i);
+
+  auto start_time = std::chrono::steady_clock::now();
+  for (const auto key : batch)
+    by_add.add(key);
+  const auto add_duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time);
+
+  start_time = std::chrono::steady_clock::now();
+  for (auto it = batch.begin(); it < batch.end(); it += batch_size) 
+    by_batch.add_batch(it, std::min(it + batch_size, batch.end()));
+  const auto batch_duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time);
+
+  assert(by_add.size() == bound && by_batch.size() == bound);
+  std::cout << "bench_add_sorted_batch, set size = " << bound << ", batch size = " << batch_size;
+  std::cout << ", add(ms) = " << add_duration.count() << ", add_batch(ms) = " << batch_duration.count() << '\n';
+}
+
+// the size counter alone, i.e. the cost of ++size_ and --size_ in add() and remove(),
+// one std::atomic<int> for all threads vs. StripedCounter
+void bench_size_counter_scale(const int ops) {
+  for (int thread_num = 1; thread_num <= 32; thread_num *= 2) {
+    std::atomic<int> single{0};
+    sss::StripedCounter striped(32);
+
+    std::vector<std::thread> threads;
+    auto start_time = std::chrono::steady_clock::now();
+    for (int i = 0; i < thread_num; ++i) {
+      threads.push_back(std::thread([&single, ops]() {
+        for (int n = 0; n < ops; ++n) 
+          ++single;
+      }));
+    }
+    for (auto& th : threads) 
+      th.join();
+    const auto single_duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time);
+
+    threads.clear();
+    start_time = std::chrono::steady_clock::now();
+    for (int i = 0; i < thread_num; ++i) {
+      threads.push_back(std::thread([&striped, ops]() {
+        for (int n = 0; n < ops; ++n) 
+          striped.add(1);
+      }));
+    }
+    for (auto& th : threads) 
+      th.join();
+    const auto striped_duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time);
+
+    assert(single.load() == thread_num * ops && striped.sum() == thread_num * ops);
+    std::cout << "bench_size_counter_scale, thread nums = " << thread_num << ", ops per thread = " << ops;
+    std::cout << ", std::atomic(ms) = " << single_duration.count() << ", StripedCounter(ms) = " << striped_duration.count() << '\n';
+  }
+}
+
 void bench_add() {
   // bench_add_random_single_thread(8<<20);  // 8 million
 
   // bench_add_random_multi_threads(16, 8<<20);
 
+  // bench_add_scale(8<<20);
+
+  // bench_size_counter_scale(1<<24);
+
+  // bench_add_sorted_batch(8<<20, 1024);
+
   // bench_add_random_by_one_skipset(8<<20);
 
   // bench_add_random_by_multi_skipset(8, 8<<20);
@@ -235,6 +327,28 @@ void bench_scan_lockfreeskipset(const std::vector<int>& nums,
   std::cout << "bench_scan_lockfreeskipset (us) = " << duration.count() << ", total = " << total << '\n';
 }
 
+// scan() seeks the lower bound and streams level0, vs. locate() and Iterator in bench_scan_lockfreeskipset()
+// NOTE: the scan scope is the count of keys, so hi is start+scan_scope-1 because keys are dense
+void bench_scan_lockfreeskipset_by_scan(const std::vector<int>& nums,
+                                        const std::vector<int>& starts, const int scan_scope,
+                                        const sss::ScanMode mode) {
+  sss::LockFreeSkipSet<int, sss::EpochReclaimer, sss::NoBackoff, sss::NoHashIndex, sss::WriteCounter> lfss;
+  for (const auto num : nums) {
+    lfss.add(num);
+  }
+
+  long long sum = 0;
+  int total = 0;
+  const auto start_time = std::chrono::steady_clock::now();
+  for (const auto start : starts) {
+    total += lfss.scan(start, start+scan_scope-1, [&sum](const int key) { sum += key; }, mode);
+  }
+  const auto end_time = std::chrono::steady_clock::now();
+  const auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time-start_time);
+  std::cout << "bench_scan_lockfreeskipset_by_scan, mode = " << (mode == sss::ScanMode::kWeak ? "weak" : "point in time");
+  std::cout << " (us) = " << duration.count() << ", total = " << total << ", sum = " << sum << '\n';
+}
+
 void bench_scan_cmp() {
   constexpr int bound = 8<<20;
   constexpr int start_num = 1<<10;    // 1024
@@ -246,6 +360,8 @@ void bench_scan_cmp() {
   // bench_scan_skipset(nums, starts, scan_scope);
   bench_scan_vectskipset(nums, starts, scan_scope);
   // bench_scan_lockfreeskipset(nums, starts, scan_scope, 16);
+  // bench_scan_lockfreeskipset_by_scan(nums, starts, scan_scope, sss::ScanMode::kWeak);
+  // bench_scan_lockfreeskipset_by_scan(nums, starts, scan_scope, sss::ScanMode::kPointInTime);
 }
 
 void scan_in_random_by_lfss(const int set_sz, const int scope, const std::vector<int>& scan_starts) {
@@ -314,6 +430,597 @@ void bench_range_scan_in_random_and_contiguous() {
   scan_in_contiguous_by_lffss(set_sz, scope, scan_starts);
 }
 
+// contains() of all keys in random order, so nearly every level hop is a cache miss,
+// which is what the inline tower of the node layout saves
+void bench_lookup_random(const int set_sz) {
+  const auto nums = random_nums(set_sz);
+
+  sss::LockFreeSkipSet<int> lfss;
+  for (const auto num : nums)
+    lfss.add(num);
+
+  const auto lookups = random_nums(set_sz);
+  int found = 0;
+  const auto start_time = std::chrono::steady_clock::now();
+  for (const auto num : lookups) {
+    if (lfss.contains(num))
+      ++found;
+  }
+  const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time);
+  assert(found == set_sz);
+  std::cout << "-- Lookup in random order for Lock Free Skip Set, total " << found << " in(ms) = " << duration.count() << '\n';
+}
+
+void bench_layout() {
+  bench_lookup_random(8 << 20);   // 8 Million
+  bench_range_scan_in_random_and_contiguous();
+}
+
+// NOTE: ru_maxrss is in KB for Linux but in bytes for MacOS
+long peak_rss() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+// read-mostly mix like an event-loop thread, 90% contains(), 5% add() and 5% remove(),
+// and announce a quiescent point after each batch of events
+template <class Reclaimer>
+void read_mostly_one_thread_f(const int seed, const int ops, const int bound, 
+                              sss::LockFreeSkipSet<int, Reclaimer>& lfss) {
+  std::mt19937 g(seed);
+  for (int i = 0; i < ops; ++i) {
+    const int num = g() % bound;
+    const int action = g() % 20;
+    if (action == 0) {
+      lfss.add(num);
+    } else if (action == 1) {
+      lfss.remove(num);
+    } else {
+      lfss.contains(num);
+    }
+
+    if (i % 64 == 0)
+      lfss.quiescent();
+  }
+  lfss.offline();
+}
+
+template <class Reclaimer>
+void bench_reclaim_read_mostly(const char* name, const int thread_num, const int bound, const int ops) {
+  sss::LockFreeSkipSet<int, Reclaimer> lfss;
+  for (int i = 0; i < bound; i += 2) {
+    lfss.add(i);
+  }
+  // NOTE: the pre-fill brings the main thread online in QsbrReclaimer, and it only joins from now on,
+  //       so it must go offline, otherwise it holds back the grace period and nothing is freed
+  lfss.offline();
+
+  std::vector<std::thread> threads;
+  const auto start_time = std::chrono::steady_clock::now();
+  for (int i = 0; i < thread_num; ++i) {
+    threads.push_back(std::thread(read_mostly_one_thread_f<Reclaimer>, i, ops, bound, std::ref(lfss)));
+  }
+  for (auto& th : threads) {
+    th.join();
+  }
+  const auto duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time);
+  std::cout << "bench_reclaim_read_mostly for " << name << ", thread nums = " << thread_num;
+  std::cout << ", ops per thread = " << ops << ", duration(us) = " << duration.count();
+  std::cout << ", peak rss = " << peak_rss() << '\n';
+}
+
+// NOTE: LeakReclaimer is the last one, because peak rss can only grow
+void bench_reclaim_cmp() {
+  constexpr int thread_num = 8;
+  constexpr int bound = 1 << 16;
+  constexpr int ops = 4 << 20;
+
+  bench_reclaim_read_mostly<sss::QsbrReclaimer>("QsbrReclaimer", thread_num, bound, ops);
+  bench_reclaim_read_mostly<sss::EpochReclaimer>("EpochReclaimer", thread_num, bound, ops);
+  bench_reclaim_read_mostly<sss::LeakReclaimer>("LeakReclaimer", thread_num, bound, ops);
+}
+
+// a timer scheduler, each thread adds a deadline and pops the smallest one alternately, 
+// the queue keeps about `initial` items. Compare try_pop_min() with std::priority_queue guarded by a mutex
+template <class AddF, class PopF>
+long long pop_min_threads(const int thread_num, const int ops, AddF add, PopF pop) {
+  std::vector<std::thread> threads;
+  const auto start_time = std::chrono::steady_clock::now();
+  for (int i = 0; i < thread_num; ++i) {
+    threads.push_back(std::thread([&add, &pop, ops, i]() {
+      std::mt19937 g(i);
+      for (int n = 0; n < ops; ++n) {
+        add(static_cast<int>(g() & 0x7fffffff));
+        pop();
+      }
+    }));
+  }
+  for (auto& th : threads) 
+    th.join();
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+void bench_pop_min_cmp() {
+  constexpr int initial = 1 << 16;
+  constexpr int ops = 1 << 18;
+
+  for (int thread_num = 1; thread_num <= 32; thread_num *= 2) {
+    std::mt19937 g(2023);
+
+    sss::LockFreeSkipSet<int> lfss;
+    for (int i = 0; i < initial; ++i)
+      lfss.add(static_cast<int>(g() & 0x7fffffff));
+    const auto lfss_ms = pop_min_threads(thread_num, ops, 
+                                         [&lfss](const int key) { lfss.add(key); },
+                                         [&lfss]() { lfss.try_pop_min(); });
+
+    std::mutex mutex;
+    std::priority_queue<int, std::vector<int>, std::greater<int>> pq;
+    for (int i = 0; i < initial; ++i)
+      pq.push(static_cast<int>(g() & 0x7fffffff));
+    const auto pq_ms = pop_min_threads(thread_num, ops,
+                                       [&mutex, &pq](const int key) { std::lock_guard<std::mutex> lock(mutex); pq.push(key); },
+                                       [&mutex, &pq]() { std::lock_guard<std::mutex> lock(mutex); if (!pq.empty()) pq.pop(); });
+
+    std::cout << "bench_pop_min_cmp, thread nums = " << thread_num << ", ops per thread = " << ops;
+    std::cout << ", LockFreeSkipSet(ms) = " << lfss_ms << ", mutex priority_queue(ms) = " << pq_ms << '\n';
+  }
+}
+
+// the queue is filled with all keys at first, then all threads pop until it is empty.
+// Compare the exact try_pop_min() with the relaxed spray_pop(). The rank error of a pop is
+// the number of keys smaller than the popped one which are still in the queue,
+// it is replayed by the order of a ticket taken after each pop, so it is not exact for try_pop_min() neither
+void bench_spray_pop_cmp() {
+  constexpr int ops = 1 << 16;
+
+  for (const int thread_num : {1, 2, 4, 8, 16, 32}) {
+    const int bound = thread_num * ops;
+    const auto pop_all = [thread_num, bound](const bool spray, double& rank_error) {
+      sss::LockFreeSkipSet<int> lfss;
+      for (int i = 0; i < bound; ++i)
+        lfss.add(i);
+
+      sss::SprayParams params;
+      params.threads = thread_num;
+      std::atomic<int> ticket{0};
+      std::vector<int> popped(bound);
+      std::vector<std::thread> threads;
+      const auto start_time = std::chrono::steady_clock::now();
+      for (int t = 0; t < thread_num; ++t) {
+        threads.push_back(std::thread([&]() {
+          while (auto key = spray ? lfss.spray_pop(params) : lfss.try_pop_min()) {
+            popped[ticket.fetch_add(1, std::memory_order_relaxed)] = *key;
+          }
+        }));
+      }
+      for (auto& th : threads)
+        th.join();
+      const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count();
+
+      // fenwick tree of the popped keys
+      std::vector<int> tree(bound+1, 0);
+      long long error_sum = 0;
+      for (const int key : popped) {
+        int smaller_popped = 0;
+        for (int i = key; i > 0; i -= i & -i)
+          smaller_popped += tree[i];
+        error_sum += key - smaller_popped;
+        for (int i = key+1; i <= bound; i += i & -i)
+          ++tree[i];
+      }
+      rank_error = static_cast<double>(error_sum) / bound;
+      return ms;
+    };
+
+    double exact_error = 0, spray_error = 0;
+    const auto exact_ms = pop_all(false, exact_error);
+    const auto spray_ms = pop_all(true, spray_error);
+    std::cout << "bench_spray_pop_cmp, thread nums = " << thread_num << ", pops = " << bound;
+    std::cout << ", try_pop_min(ms) = " << exact_ms << ", rank error = " << exact_error;
+    std::cout << ", spray_pop(ms) = " << spray_ms << ", rank error = " << spray_error << '\n';
+  }
+}
+
+// random strings of 32 bytes which are not in SSO, so std::string chases the heap pointer for each compare
+std::vector<std::string> random_strings(const int n) {
+  std::mt19937 g(2023);
+  std::vector<std::string> strs(n);
+  for (auto& s : strs) {
+    for (int i = 0; i < 32; ++i)
+      s.push_back(static_cast<char>('a' + g() % 26));
+  }
+  return strs;
+}
+
+template <class Set, class Probe>
+void bench_string_keys_one(const char* name, const std::vector<std::string>& strs, const std::vector<std::string>& lookups) {
+  Set set;
+  auto start_time = std::chrono::steady_clock::now();
+  for (const auto& s : strs)
+    set.insert(s);
+  const auto insert_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count();
+
+  start_time = std::chrono::steady_clock::now();
+  std::size_t found = 0;
+  for (const auto& s : lookups) {
+    if (set.contains(Probe(s)))
+      ++found;
+  }
+  const auto lookup_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count();
+  assert(found == lookups.size());
+  std::cout << "-- " << name << ", insert(ms) = " << insert_ms << ", lookup(ms) = " << lookup_ms << '\n';
+}
+
+// LockFreeSkipSet and LazySkipSet have add() instead of insert()
+template <class T, class Set = sss::LockFreeSkipSet<T>>
+struct LfssInsert : Set {
+  bool insert(const T& key) { return this->add(key); }
+  bool erase(const T& key) { return this->remove(key); }
+};
+
+// std::string keys vs PrefixString keys, the PrefixString lookups are by std::string_view
+void bench_string_keys() {
+  const auto strs = random_strings(1 << 20);
+  auto lookups = strs;
+  std::shuffle(lookups.begin(), lookups.end(), std::mt19937(7));
+
+  bench_string_keys_one<sss::SkipSet<std::string>, const std::string&>("SkipSet<std::string>", strs, lookups);
+  bench_string_keys_one<sss::SkipSet<sss::PrefixString>, std::string_view>("SkipSet<PrefixString>", strs, lookups);
+  bench_string_keys_one<LfssInsert<std::string>, const std::string&>("LockFreeSkipSet<std::string>", strs, lookups);
+  bench_string_keys_one<LfssInsert<sss::PrefixString>, std::string_view>("LockFreeSkipSet<PrefixString>", strs, lookups);
+}
+
+// point lookups with and without the hash index, for index slots of 1x, 2x and 4x of the keys.
+// The index costs 8 bytes for each slot, and the lookups of present keys take one probe
+// unless the window of the key is full, the absent keys pay the probe then the skip set search
+template <class Set>
+void bench_hash_index_one(Set& set, const std::vector<int>& nums, const int set_sz, const char* name) {
+  for (int i = 0; i < set_sz; ++i)
+    set.add(nums[i]);
+
+  auto start_time = std::chrono::steady_clock::now();
+  int found = 0;
+  for (int i = 0; i < set_sz; ++i) {
+    if (set.contains(nums[(i * 7919LL) % set_sz]))
+      ++found;
+  }
+  const auto present_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count();
+  assert(found == set_sz);
+
+  start_time = std::chrono::steady_clock::now();
+  for (int i = 0; i < set_sz; ++i) {
+    if (set.contains(nums[set_sz + i]))
+      ++found;
+  }
+  const auto absent_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count();
+  assert(found == set_sz);
+
+  std::cout << "-- " << name << ", index(MB) = " << set.index_memory() / (1 << 20);
+  std::cout << ", present lookup(ms) = " << present_ms << ", absent lookup(ms) = " << absent_ms << '\n';
+}
+
+void bench_hash_index() {
+  using IndexedSet = sss::LockFreeSkipSet<int, sss::EpochReclaimer, sss::NoBackoff, sss::HashIndex<>>;
+  constexpr int set_sz = 1 << 21;
+  const auto nums = random_nums(set_sz * 2);   // the second half is absent
+
+  {
+    sss::LockFreeSkipSet<int> lfss;
+    bench_hash_index_one(lfss, nums, set_sz, "no index");
+  }
+  for (const int times : {1, 2, 4}) {
+    IndexedSet lfss(static_cast<std::size_t>(set_sz) * times);
+    const std::string name = "index slots = " + std::to_string(times) + "x keys";
+    bench_hash_index_one(lfss, nums, set_sz, name.c_str());
+  }
+}
+
+// random adds then lookups by 1 to 32 threads, ShardedSkipSet of 64 shards vs. LockFreeSkipSet.
+// The splits are from a sample of 1% of the keys
+template <class Set>
+long long bench_sharded_one(Set& set, const std::vector<int>& nums, const int thread_num) {
+  const int per_thread = static_cast<int>(nums.size()) / thread_num;
+  std::vector<std::thread> threads;
+  const auto start_time = std::chrono::steady_clock::now();
+  for (int t = 0; t < thread_num; ++t) {
+    threads.push_back(std::thread([&set, &nums, per_thread, t]() {
+      for (int i = t*per_thread; i < (t+1)*per_thread; ++i)
+        set.insert(nums[i]);
+      for (int i = t*per_thread; i < (t+1)*per_thread; ++i)
+        set.contains(nums[i]);
+    }));
+  }
+  for (auto& th : threads)
+    th.join();
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+void bench_sharded_scale() {
+  constexpr int bound = 4 << 20;
+  const auto nums = random_nums(bound);
+  const std::vector<int> sample(nums.begin(), nums.begin() + bound/100);
+
+  for (int thread_num = 1; thread_num <= 32; thread_num *= 2) {
+    sss::ShardedSkipSet<int> sharded(64, sample);
+    const auto sharded_ms = bench_sharded_one(sharded, nums, thread_num);
+    LfssInsert<int> lfss;
+    const auto lfss_ms = bench_sharded_one(lfss, nums, thread_num);
+    std::cout << "bench_sharded_scale, threads = " << thread_num << ", ShardedSkipSet(ms) = " << sharded_ms;
+    std::cout << ", LockFreeSkipSet(ms) = " << lfss_ms << '\n';
+  }
+}
+
+// 80% contains(), 10% insert() and 10% erase() of random keys in a set of 64K keys by 1 to 64 threads,
+// the total ops are the same for each thread count, FlatCombiningSkipSet vs. LockFreeSkipSet
+template <class Set>
+long long bench_mixed_ops(Set& set, const int thread_num, const int total_ops, const int bound) {
+  for (int i = 0; i < bound; i += 2)
+    set.insert(i);
+
+  std::vector<std::thread> threads;
+  const auto start_time = std::chrono::steady_clock::now();
+  for (int t = 0; t < thread_num; ++t) {
+    threads.push_back(std::thread([&set, t, ops = total_ops / thread_num, bound]() {
+      std::mt19937 g(t);
+      for (int i = 0; i < ops; ++i) {
+        const int key = g() % bound;
+        const int action = g() % 10;
+        if (action == 0) {
+          set.insert(key);
+        } else if (action == 1) {
+          set.erase(key);
+        } else {
+          set.contains(key);
+        }
+      }
+    }));
+  }
+  for (auto& th : threads)
+    th.join();
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+void bench_flat_combining_cmp() {
+  constexpr int total_ops = 1 << 22;
+  constexpr int bound = 1 << 17;
+  for (int thread_num = 1; thread_num <= 64; thread_num *= 2) {
+    sss::FlatCombiningSkipSet<int> fcss;
+    const auto fc_ms = bench_mixed_ops(fcss, thread_num, total_ops, bound);
+    LfssInsert<int> lfss;
+    const auto lfss_ms = bench_mixed_ops(lfss, thread_num, total_ops, bound);
+    std::cout << "bench_flat_combining_cmp, threads = " << thread_num << ", FlatCombiningSkipSet(ms) = " << fc_ms;
+    std::cout << " (avg batch = " << fcss.avg_batch() << "), LockFreeSkipSet(ms) = " << lfss_ms << '\n';
+  }
+}
+
+// mixed ops of bench_mixed_ops() by 1 to 32 threads, LazySkipSet vs. LockFreeSkipSet,
+// in a set of 64K keys, then in a set of 512 keys where the writers often lock the same preds
+void bench_lazy_cmp() {
+  constexpr int total_ops = 1 << 22;
+  for (const int bound : {1 << 17, 1 << 10}) {
+    for (int thread_num = 1; thread_num <= 32; thread_num *= 2) {
+      LfssInsert<int, sss::LazySkipSet<int>> lazy;
+      const auto lazy_ms = bench_mixed_ops(lazy, thread_num, total_ops, bound);
+      LfssInsert<int> lfss;
+      const auto lfss_ms = bench_mixed_ops(lfss, thread_num, total_ops, bound);
+      std::cout << "bench_lazy_cmp, keys = " << bound/2 << ", threads = " << thread_num;
+      std::cout << ", LazySkipSet(ms) = " << lazy_ms << ", LockFreeSkipSet(ms) = " << lfss_ms << '\n';
+    }
+  }
+}
+
+// one writer keeps inserting and erasing random keys in a set of 64K keys, while 1 to 32 readers run contains(),
+// the reader throughput of SwmrSkipSet vs. SkipSet under a mutex vs. LockFreeSkipSet.
+// NOTE: the set is filled in random order, otherwise the nodes of SkipSet are malloc()ed in the order of the keys
+template <class Set, class Insert, class Erase, class Contains>
+double bench_swmr_one(Set& set, const int reader_num, const int reads, Insert insert, Erase erase, Contains contains) {
+  constexpr int bound = 1 << 17;
+  for (const int num : random_nums(bound)) {
+    if (num % 2 == 0)
+      insert(set, num);
+  }
+
+  std::atomic<bool> stop{false};
+  std::thread writer([&set, &stop, &insert, &erase]() {
+    std::mt19937 g(2023);
+    while (!stop.load(std::memory_order_relaxed)) {
+      const int key = g() % bound;
+      if (g() % 2 == 0) {
+        insert(set, key);
+      } else {
+        erase(set, key);
+      }
+    }
+  });
+
+  // NOTE: the results are summed, otherwise contains() of SkipSet which has no atomic could be optimized out
+  std::vector<std::thread> readers;
+  std::atomic<int> found{0};
+  const auto start_time = std::chrono::steady_clock::now();
+  for (int t = 0; t < reader_num; ++t) {
+    readers.push_back(std::thread([&set, &contains, &found, t, ops = reads / reader_num]() {
+      std::mt19937 g(t);
+      int n = 0;
+      for (int i = 0; i < ops; ++i)
+        n += contains(set, static_cast<int>(g() % bound));
+      found.fetch_add(n);
+    }));
+  }
+  for (auto& th : readers)
+    th.join();
+  const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count();
+  stop.store(true);
+  writer.join();
+  assert(found.load() > 0);
+  return static_cast<double>(reads) / std::max<long long>(ms, 1) / 1000;
+}
+
+void bench_swmr_readers() {
+  struct LockedSkipSet {
+    std::mutex mutex;
+    sss::SkipSet<int> set;
+  };
+  constexpr int reads = 1 << 22;
+  for (int reader_num = 1; reader_num <= 32; reader_num *= 2) {
+    sss::SwmrSkipSet<int> swmr;
+    const auto swmr_mops = bench_swmr_one(swmr, reader_num, reads,
+      [](auto& s, const int key) { s.insert(key); }, [](auto& s, const int key) { s.erase(key); },
+      [](auto& s, const int key) { return s.contains(key); });
+    LockedSkipSet locked;
+    const auto locked_mops = bench_swmr_one(locked, reader_num, reads,
+      [](auto& s, const int key) { std::lock_guard<std::mutex> lock(s.mutex); s.set.insert(key); },
+      [](auto& s, const int key) { std::lock_guard<std::mutex> lock(s.mutex); s.set.erase(key); },
+      [](auto& s, const int key) { std::lock_guard<std::mutex> lock(s.mutex); return s.set.contains(key); });
+    sss::LockFreeSkipSet<int> lfss;
+    const auto lfss_mops = bench_swmr_one(lfss, reader_num, reads,
+      [](auto& s, const int key) { s.add(key); }, [](auto& s, const int key) { s.remove(key); },
+      [](auto& s, const int key) { return s.contains(key); });
+    std::cout << "bench_swmr_readers, readers = " << reader_num << ", read Mops/s of SwmrSkipSet = " << swmr_mops;
+    std::cout << ", SkipSet with mutex = " << locked_mops << ", LockFreeSkipSet = " << lfss_mops << '\n';
+  }
+}
+
+// SkipSet and ASkipSet nodes from SlabAllocator: inserts of random keys, a scan of all keys, and lookups in random order,
+// then the same for sorted inserts whose nodes of a height are adjacent in the slabs.
+// Run it in a process of its own for the peak RSS
+void bench_slab_skipset(const int set_sz) {
+  const auto random = random_nums(set_sz);
+  auto sorted = random;
+  std::sort(sorted.begin(), sorted.end());
+  const auto lookups = random_nums(set_sz);
+
+  for (const bool is_sorted : {false, true}) {
+    const auto& nums = is_sorted ? sorted : random;
+    sss::SkipSet<int> ss;
+    auto start_time = std::chrono::steady_clock::now();
+    for (const auto num : nums)
+      ss.insert(num);
+    const auto insert_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count();
+
+    start_time = std::chrono::steady_clock::now();
+    long long sum = 0;
+    for (auto it = ss.begin(); it != ss.end(); ++it)
+      sum += *it;
+    const auto scan_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count();
+    assert(sum == static_cast<long long>(set_sz) * (set_sz-1) / 2);
+
+    start_time = std::chrono::steady_clock::now();
+    int found = 0;
+    for (const auto num : lookups)
+      found += ss.contains(num);
+    const auto lookup_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count();
+    assert(found == set_sz);
+
+    std::cout << "bench_slab_skipset, " << (is_sorted ? "sorted" : "random") << " inserts of " << set_sz;
+    std::cout << ", insert(ms) = " << insert_ms << ", scan(ms) = " << scan_ms << ", lookup(ms) = " << lookup_ms;
+    std::cout << ", peak rss(KB) = " << peak_rss() << '\n';
+  }
+}
+
+// mixed ops of bench_mixed_ops() by client threads, with the latency of each op, in three ways
+// 1. a DelegationServer of SkipSet, each op is posted then waited, i.e. a round trip to the server
+// 2. a DelegationServer of SkipSet, the client posts a batch of 16 ops, then waits for them,
+//    the latency of an op is from the post of the batch to its result
+// 3. LockFreeSkipSet, each op is run by the client itself
+// NOTE: the server thread needs its own core, so the clients should be fewer than the cores
+template <class Run>
+void bench_delegation_one(const char* name, const int thread_num, const int ops, Run run) {
+  std::vector<std::vector<int64_t>> latencies(thread_num);
+  std::vector<std::thread> threads;
+  const auto start_time = std::chrono::steady_clock::now();
+  for (int t = 0; t < thread_num; ++t) {
+    threads.push_back(std::thread([&run, &latencies, t, ops]() {
+      latencies[t].reserve(ops);
+      run(t, ops, latencies[t]);
+    }));
+  }
+  for (auto& th : threads)
+    th.join();
+  const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count();
+
+  std::vector<int64_t> all;
+  for (const auto& l : latencies)
+    all.insert(all.end(), l.begin(), l.end());
+  std::sort(all.begin(), all.end());
+  const auto percentile = [&all](const double p) { return all[static_cast<size_t>(p * (all.size()-1))]; };
+  std::cout << "bench_delegation_cmp, " << name << ", clients = " << thread_num;
+  std::cout << ", Mops/s = " << static_cast<double>(ops) * thread_num / std::max<long long>(ms, 1) / 1000;
+  std::cout << ", p50(ns) = " << percentile(0.5) << ", p99(ns) = " << percentile(0.99) << '\n';
+}
+
+void bench_delegation_cmp() {
+  using Server = sss::DelegationServer<sss::SkipSet<int>>;
+  constexpr int bound = 1 << 17;
+  constexpr int ops = 1 << 18;
+  constexpr int batch = 16;
+  const auto now = []() { return std::chrono::steady_clock::now(); };
+  const auto ns = [](const auto d) { return std::chrono::duration_cast<std::chrono::nanoseconds>(d).count(); };
+  const auto random_op = [](std::mt19937& g) {
+    const int action = g() % 10;
+    return action == 0 ? Server::kInsert : action == 1 ? Server::kErase : Server::kContains;
+  };
+
+  for (int thread_num = 1; thread_num <= 8; thread_num *= 2) {
+    {
+      Server server;
+      {
+        auto client = server.connect();
+        for (int i = 0; i < bound; i += 2)
+          client.insert(i);
+      }
+      bench_delegation_one("delegation", thread_num, ops, [&](const int t, const int ops, std::vector<int64_t>& lat) {
+        auto client = server.connect();
+        std::mt19937 g(t);
+        for (int i = 0; i < ops; ++i) {
+          const auto op = random_op(g);
+          const int key = g() % bound;
+          const auto start = now();
+          client.wait(client.post(op, key));
+          lat.push_back(ns(now() - start));
+        }
+      });
+      bench_delegation_one("delegation batch 16", thread_num, ops, [&](const int t, const int ops, std::vector<int64_t>& lat) {
+        auto client = server.connect();
+        std::mt19937 g(t);
+        uint64_t tickets[batch];
+        for (int i = 0; i < ops; i += batch) {
+          const auto start = now();
+          for (int j = 0; j < batch; ++j) {
+            const auto op = random_op(g);
+            tickets[j] = client.post(op, g() % bound);
+          }
+          for (int j = 0; j < batch; ++j) {
+            client.wait(tickets[j]);
+            lat.push_back(ns(now() - start));
+          }
+        }
+      });
+    }
+
+    LfssInsert<int> lfss;
+    for (int i = 0; i < bound; i += 2)
+      lfss.insert(i);
+    bench_delegation_one("LockFreeSkipSet", thread_num, ops, [&](const int t, const int ops, std::vector<int64_t>& lat) {
+      std::mt19937 g(t);
+      for (int i = 0; i < ops; ++i) {
+        const auto op = random_op(g);
+        const int key = g() % bound;
+        const auto start = now();
+        if (op == Server::kInsert) {
+          lfss.insert(key);
+        } else if (op == Server::kErase) {
+          lfss.erase(key);
+        } else {
+          lfss.contains(key);
+        }
+        lat.push_back(ns(now() - start));
+      }
+    });
+  }
+}
+
 int main() {
   // bench_add();
 
@@ -321,5 +1028,29 @@ int main() {
 
   // bench_range_scan_in_random_and_contiguous();
 
+  // bench_layout();
+
+  // bench_reclaim_cmp();
+
+  // bench_pop_min_cmp();
+
+  // bench_spray_pop_cmp();
+
+  // bench_string_keys();
+
+  // bench_hash_index();
+
+  // bench_sharded_scale();
+
+  // bench_flat_combining_cmp();
+
+  // bench_delegation_cmp();
+
+  // bench_lazy_cmp();
+
+  // bench_swmr_readers();
+
+  // bench_slab_skipset(8<<20);
+
   return 0;
 }
\ No newline at end of file
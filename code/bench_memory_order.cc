@@ -0,0 +1,82 @@
+// throughput of the lock-free containers with the default seq_cst and the tuned memory orders
+// build it twice and compare, check memory_order.h
+//   g++ -std=c++17 -O2 -pthread bench_memory_order.cc -o bench_seq_cst
+//   g++ -std=c++17 -O2 -pthread -DSSS_TUNED_MEMORY_ORDER bench_memory_order.cc -o bench_tuned
+
+#include <iostream>
+#include <random>
+#include <thread>
+#include <chrono>
+#include <vector>
+
+#include "lock_free_skip_set.h"
+#include "lock_free_set_link_list.h"
+
+// update_percent of operations are add() or remove(), others are contains()
+template <class Set>
+void mix_one_thread_f(const int seed, const int ops, const int bound, const int update_percent, Set& set) {
+  std::mt19937 g(seed);
+  for (int i = 0; i < ops; ++i) {
+    const int num = g() % bound;
+    const int action = g() % 100;
+    if (action < update_percent / 2) {
+      set.add(num);
+    } else if (action < update_percent) {
+      set.remove(num);
+    } else {
+      set.contains(num);
+    }
+
+    if (i % 64 == 0)
+      set.quiescent();
+  }
+  set.offline();
+}
+
+template <class Set>
+void bench_mix(const char* name, const int thread_num, const int bound, const int ops, const int update_percent) {
+  Set set;
+  for (int i = 0; i < bound; i += 2) {
+    set.add(i);
+  }
+
+  std::vector<std::thread> threads;
+  const auto start_time = std::chrono::steady_clock::now();
+  for (int i = 0; i < thread_num; ++i) {
+    threads.push_back(std::thread(mix_one_thread_f<Set>, i, ops, bound, update_percent, std::ref(set)));
+  }
+  for (auto& th : threads) {
+    th.join();
+  }
+  const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time);
+  const double mops = static_cast<double>(thread_num) * ops / 1000 / (duration.count() + 1);
+  std::cout << name << ", tuned = " << (sss::kTunedMemoryOrder ? "true" : "false");
+  std::cout << ", thread nums = " << thread_num << ", update% = " << update_percent;
+  std::cout << ", duration(ms) = " << duration.count() << ", Mops/s = " << mops << '\n';
+}
+
+void bench_lfss() {
+  constexpr int bound = 1 << 20;
+  constexpr int ops = 1 << 20;
+  for (const int thread_num : {1, 4, 16}) {
+    bench_mix<sss::LockFreeSkipSet<int>>("LockFreeSkipSet", thread_num, bound, ops, 10);
+    bench_mix<sss::LockFreeSkipSet<int>>("LockFreeSkipSet", thread_num, bound, ops, 50);
+  }
+}
+
+void bench_lfsll() {
+  constexpr int bound = 1 << 10;
+  constexpr int ops = 1 << 18;
+  for (const int thread_num : {1, 4, 16}) {
+    bench_mix<sss::LockFreeSetLinkList<int>>("LockFreeSetLinkList", thread_num, bound, ops, 10);
+    bench_mix<sss::LockFreeSetLinkList<int>>("LockFreeSetLinkList", thread_num, bound, ops, 50);
+  }
+}
+
+int main() {
+  bench_lfss();
+
+  bench_lfsll();
+
+  return 0;
+}
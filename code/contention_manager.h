@@ -0,0 +1,77 @@
+// contention managers for the CAS retry loops of the lock-free containers
+//
+// A failed CAS means another thread has just changed the same node. When many threads hit the same keys,
+// retrying immediately makes all of them bounce the same cache lines, and most retries fail again.
+// A contention manager decides how long a thread waits before the retry.
+//
+// It is a template parameter of the containers like the Reclaimer. Each retry loop owns one on its stack, e.g.
+//   Backoff backoff;
+//   while (!cas()) backoff.fail();
+// 1. NoBackoff (default), retry immediately, i.e. no cost when there is no contention
+// 2. ExponentialBackoff, spin a random number of pauses in [0, limit), and the limit doubles after each failure
+//    until kMaxLimit. The jitter avoids that the failed threads retry at the same time again.
+//    When the limit reaches kMaxLimit, it yields the CPU too, e.g. the winner could be preempted
+// 3. PauseSpin, spin a fixed number of pauses, i.e. a short delay which lets the winner finish its CAS
+//
+// NOTE: the pause instruction tells the CPU that it is a spin loop, so it does not flood the memory system
+//       and gives the resource to the hyper thread sibling. Check cas_vs_mutex.cc for the cost of CAS under contention.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include "thread_random.h"
+
+namespace sss {
+
+inline void cpu_pause() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield" ::: "memory");
+#else
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+
+class NoBackoff {
+public:
+  void fail() noexcept {}
+};
+
+class ExponentialBackoff {
+public:
+  void fail() noexcept {
+    for (auto n = ThreadRandom::next() & (limit_-1); n > 0; --n) {
+      cpu_pause();
+    }
+
+    if (limit_ < kMaxLimit) {
+      limit_ <<= 1;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+
+private:
+  static constexpr uint32_t kMinLimit = 4;      // NOTE: must be power of 2
+  static constexpr uint32_t kMaxLimit = 1024;   // NOTE: must be power of 2
+
+  uint32_t limit_ = kMinLimit;
+};
+
+class PauseSpin {
+public:
+  void fail() noexcept {
+    for (int i = 0; i < kPauses; ++i) {
+      cpu_pause();
+    }
+  }
+
+private:
+  static constexpr int kPauses = 16;
+};
+
+} // namespace sss
@@ -0,0 +1,225 @@
+// delegation server, i.e. one server thread exclusively owns a single-threaded set, e.g. SkipSet or VectSkipSet,
+// and the client threads send it the operations instead of touching the set
+// reference: Sepideh Roghanchi, Jakob Eriksson, Nilanjana Basu, <<ffwd: delegation is (much) faster than you think>>
+//
+// Like FlatCombiningSkipSet, the set is only visited by one thread, so it stays in the L1/L2 cache of the server
+// and needs no atomics. Unlike flat combining, the server is a dedicated thread, e.g. pinned to its own core,
+// so the clients never run the set code and never wait for a lock, and the cache of the set never moves between cores.
+//
+// Each client has its own channel:
+// 1. a SpscRing of requests from the client to the server, so a client can post a batch of requests without waiting,
+// 2. the completion slots of results, one for each request in flight, and done, the number of requests served.
+// The server round-robins the channels, consumes a batch from each ring, writes the results,
+// then publishes done once for the batch. A client waits for a ticket by spinning on done of its own channel.
+//
+// NOTE: the server thread spins when it is idle, so it burns one core.
+//       It yields after kIdleSpins empty rounds, otherwise it would starve the clients when the cores are fewer than the threads.
+//       All Clients must be destroyed before the DelegationServer.
+
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <memory>
+#include <cstdint>
+#include <cassert>
+
+#include "spsc_ring.h"
+#include "contention_manager.h"
+
+namespace sss {
+
+template <class Set>
+class DelegationServer {
+public:
+  enum Op : int {
+    kInsert,
+    kErase,
+    kContains,
+  };
+
+private:
+  template <class T>
+  struct Request {
+    T key;
+    Op op;
+  };
+
+  // the type of the key of Set, e.g. int for SkipSet<int>
+  template <class S>
+  struct KeyOf;
+  template <template <class> class S, class T>
+  struct KeyOf<S<T>> {
+    using type = T;
+  };
+
+  using Key = typename KeyOf<Set>::type;
+
+  struct Channel {
+    explicit Channel(const std::size_t capacity)
+      : requests(capacity), results(std::make_unique<bool[]>(requests.capacity())) {}
+
+    std::atomic<bool> in_use{true};
+    SpscRing<Request<Key>> requests;
+    std::unique_ptr<bool[]> results;    // results[ticket % capacity], written by the server before done
+    uint64_t served = 0;                // the server's copy of done
+    alignas(64) std::atomic<uint64_t> done{0};
+    alignas(64) uint64_t posted = 0;    // only visited by the client
+  };
+
+public:
+  // a client is used by one thread, like the producer of a SpscRing.
+  // A ticket is the sequence number of the request in the client, its result is kept until capacity more requests are posted.
+  class Client {
+  public:
+    Client(Client&& rhs) noexcept : channel_(rhs.channel_) { rhs.channel_ = nullptr; }
+    Client(const Client&) = delete;
+    Client& operator=(const Client&) = delete;
+    Client& operator=(Client&&) = delete;
+
+    // wait for all requests, then return the channel to the server for the next client
+    ~Client() noexcept {
+      if (channel_ != nullptr) {
+        wait_done(channel_->posted);
+        channel_->in_use.store(false, std::memory_order_release);
+      }
+    }
+
+    // post a request without waiting for its result, it spins if the ring is full
+    uint64_t post(const Op op, const Key& key) {
+      while (!channel_->requests.try_push(Request<Key>{key, op}))
+        cpu_pause();
+      return channel_->posted++;
+    }
+
+    // wait for the result of the ticket
+    bool wait(const uint64_t ticket) {
+      assert(ticket < channel_->posted && channel_->posted - ticket <= channel_->requests.capacity());
+      wait_done(ticket+1);
+      return channel_->results[ticket & (channel_->requests.capacity()-1)];
+    }
+
+    bool insert(const Key& key) {
+      return wait(post(kInsert, key));
+    }
+
+    bool erase(const Key& key) {
+      return wait(post(kErase, key));
+    }
+
+    bool contains(const Key& key) {
+      return wait(post(kContains, key));
+    }
+
+  private:
+    friend class DelegationServer;
+    explicit Client(Channel* const channel) : channel_(channel) {}
+
+    void wait_done(const uint64_t done) const noexcept {
+      int spins = 0;
+      while (channel_->done.load(std::memory_order_acquire) < done) {
+        if (++spins < kWaitSpins) {
+          cpu_pause();
+        } else {
+          std::this_thread::yield();
+          spins = 0;
+        }
+      }
+    }
+
+    Channel* channel_;
+  };
+
+  // ring_capacity is the max number of requests in flight for each client
+  explicit DelegationServer(const std::size_t ring_capacity = 64)
+    : ring_capacity_(ring_capacity), channel_num_(0), stop_(false) {
+    server_ = std::thread([this]() { serve(); });
+  }
+
+  ~DelegationServer() noexcept {
+    stop_.store(true, std::memory_order_relaxed);
+    server_.join();
+  }
+
+  DelegationServer(const DelegationServer&) = delete;
+  DelegationServer& operator=(const DelegationServer&) = delete;
+
+  // reuse a channel of a destroyed client, or create a new one
+  Client connect() {
+    std::lock_guard<std::mutex> lock(connect_mutex_);
+    const int num = channel_num_.load(std::memory_order_relaxed);
+    for (int i = 0; i < num; ++i) {
+      if (!channels_[i]->in_use.load(std::memory_order_acquire)) {
+        channels_[i]->in_use.store(true, std::memory_order_relaxed);   // NOTE: posted goes on from the last client
+        return Client(channels_[i].get());
+      }
+    }
+
+    assert(num < kMaxClients);
+    channels_[num] = std::make_unique<Channel>(ring_capacity_);
+    channel_num_.store(num+1, std::memory_order_release);
+    return Client(channels_[num].get());
+  }
+
+  // e.g. pin the server thread to a core by pthread_setaffinity_np()
+  std::thread::native_handle_type native_handle() {
+    return server_.native_handle();
+  }
+
+private:
+  void serve() {
+    int idle = 0;
+    while (!stop_.load(std::memory_order_relaxed)) {
+      std::size_t served = 0;
+      for (int i = 0, num = channel_num_.load(std::memory_order_acquire); i < num; ++i) {
+        Channel& channel = *channels_[i];
+        const std::size_t mask = channel.requests.capacity() - 1;
+        const auto n = channel.requests.consume(kMaxBatch, [this, &channel, mask](const Request<Key>& request) {
+          channel.results[channel.served & mask] = apply(request);
+          ++channel.served;
+        });
+        if (n > 0) {
+          channel.done.store(channel.served, std::memory_order_release);
+          served += n;
+        }
+      }
+
+      if (served > 0) {
+        idle = 0;
+      } else if (++idle < kIdleSpins) {
+        cpu_pause();
+      } else {
+        std::this_thread::yield();
+        idle = 0;
+      }
+    }
+  }
+
+  bool apply(const Request<Key>& request) {
+    switch (request.op) {
+    case kInsert:
+      return set_.insert(request.key);
+    case kErase:
+      return set_.erase(request.key);
+    default:
+      return set_.contains(request.key);
+    }
+  }
+
+private:
+  static constexpr int kMaxClients = 256;
+  static constexpr std::size_t kMaxBatch = 32;    // for each channel in a round, so a busy client can not starve others
+  static constexpr int kIdleSpins = 1024;
+  static constexpr int kWaitSpins = 1024;
+
+  Set set_;   // only visited by the server thread
+  const std::size_t ring_capacity_;
+  std::unique_ptr<Channel> channels_[kMaxClients];
+  std::atomic<int> channel_num_;
+  std::mutex connect_mutex_;
+  std::atomic<bool> stop_;
+  std::thread server_;
+};
+
+} // namespace sss
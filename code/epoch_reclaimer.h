@@ -0,0 +1,160 @@
+// epoch based reclamation (EBR) for the lock-free containers
+// reference: Keir Fraser, <<Practical lock-freedom>>, chapter 5.2.3
+//
+// A thread enters a critical region, i.e. Guard, before it touches any node of the container.
+// When entering, it announces the global epoch it sees in its own record.
+// A node which has been unlinked is retired with the global epoch at the time of retirement.
+// The global epoch can only advance from e to e+1 when every active thread has announced e,
+// so when the global epoch reaches e+2, no thread can still hold a reference to a node retired in e.
+//
+// NOTE: entering a Guard only writes the record of the calling thread which is in its own cache line,
+// so read operations like contains() do not write any shared atomic.
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <cassert>
+
+#include "thread_slot.h"
+#include "memory_order.h"
+
+namespace sss {
+
+class EpochReclaimer {
+public:
+  static constexpr bool kNeedValidation = false;   // a node read in a Guard is always safe
+
+  class Guard {
+  public:
+    explicit Guard(EpochReclaimer& reclaimer) : reclaimer_(&reclaimer) {
+      reclaimer_->enter();
+    }
+
+    ~Guard() noexcept {
+      reclaimer_->exit();
+    }
+
+    // copy of a guard is for Iterator copy and must be in the same thread
+    Guard(const Guard& copy) : reclaimer_(copy.reclaimer_) {
+      reclaimer_->enter();
+    }
+
+    Guard& operator=(const Guard& rhs) noexcept {
+      rhs.reclaimer_->enter();
+      reclaimer_->exit();
+      reclaimer_ = rhs.reclaimer_;
+      return *this;
+    }
+
+    void protect(const int, void* const) noexcept {}
+
+  private:
+    EpochReclaimer* reclaimer_;
+  };
+
+public:
+  EpochReclaimer() : global_epoch_(kFirstEpoch) {}
+
+  // when dtor(), no thread can be in a Guard, so all retired nodes can be freed
+  ~EpochReclaimer() noexcept {
+    for (auto& record : records_) {
+      assert(record.nesting == 0);
+      for (const auto& retired : record.retired) {
+        retired.deleter(retired.ptr, retired.context);
+      }
+    }
+  }
+
+  EpochReclaimer(const EpochReclaimer&) = delete;
+  EpochReclaimer& operator=(const EpochReclaimer&) = delete;
+
+  // a thread is quiescent whenever it is out of a Guard, so nothing to do
+  void quiescent() noexcept {}
+
+  void offline() noexcept {}
+
+  // ptr must have been unlinked, i.e. no new reference to it can be acquired from now on.
+  // deleter(ptr, context) is called after all threads which could see ptr have left their Guards
+  void retire(void* const ptr, void (*deleter)(void*, void*), void* const context = nullptr) {
+    auto& record = records_[ThreadSlot::id()];
+    store_load_fence();   // the unlink of ptr must be visible before reading the epoch, check memory_order.h
+    record.retired.push_back({ptr, deleter, context, global_epoch_.load()});
+
+    if (++record.since_collect >= kRetireBatch) {
+      record.since_collect = 0;
+      try_advance();
+      collect(record);
+    }
+  }
+
+private:
+  struct Retired {
+    void* ptr;
+    void (*deleter)(void*, void*);
+    void* context;
+    uint64_t epoch;
+  };
+
+  // padding to cache line to avoid false sharing between threads
+  struct alignas(64) Record {
+    std::atomic<uint64_t> epoch{kInactive};   // the epoch announced by the thread, kInactive if not in a Guard
+    int nesting = 0;                          // Guard could be nested, e.g. an Iterator calls contains()
+    int since_collect = 0;                    // retired count since last collect()
+    std::vector<Retired> retired;             // ordered by epoch, only visited by the thread of the slot
+  };
+
+  void enter() noexcept {
+    auto& record = records_[ThreadSlot::id()];
+    if (record.nesting++ == 0) {
+      record.epoch.store(global_epoch_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+      // the announcement must be visible before any node is read, pair with the loads in try_advance()
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+  }
+
+  void exit() noexcept {
+    auto& record = records_[ThreadSlot::id()];
+    assert(record.nesting > 0);
+    if (--record.nesting == 0) {
+      record.epoch.store(kInactive, std::memory_order_release);
+    }
+  }
+
+  // advance the global epoch if all active threads have caught up with it
+  void try_advance() noexcept {
+    auto epoch = global_epoch_.load();
+
+    for (int i = 0, hw = ThreadSlot::high_water(); i < hw; ++i) {
+      const auto announced = records_[i].epoch.load();
+      if (announced != kInactive && announced != epoch)
+        return;   // some thread is still in an old epoch
+    }
+
+    global_epoch_.compare_exchange_strong(epoch, epoch+1);
+  }
+
+  // free nodes in batch which were retired at least two epochs ago
+  void collect(Record& record) noexcept {
+    const auto epoch = global_epoch_.load();
+    auto& retired = record.retired;
+
+    std::size_t safe = 0;
+    while (safe < retired.size() && retired[safe].epoch + 2 <= epoch) {
+      retired[safe].deleter(retired[safe].ptr, retired[safe].context);
+      ++safe;
+    }
+    retired.erase(retired.begin(), retired.begin()+safe);
+  }
+
+private:
+  static constexpr uint64_t kInactive = 0;
+  static constexpr uint64_t kFirstEpoch = 1;
+  static constexpr int kRetireBatch = 64;
+
+  alignas(64) std::atomic<uint64_t> global_epoch_;
+  Record records_[ThreadSlot::kMaxThreads];
+};
+
+} // namespace sss
@@ -0,0 +1,173 @@
+// flat combining concurrent set, i.e. one thread at a time applies the requests of all threads to a single-threaded SkipSet
+// reference: Danny Hendler, Itai Incze, Nir Shavit, Moran Tzafrir, <<Flat Combining and the Synchronization-Parallelism Tradeoff>>
+//
+// check lock_free_vs_thread_lock.md, a single thread in cache beats the threads which CAS at every step.
+// Each thread posts its request in its own slot, which is padded to a cache line and indexed by ThreadSlot::id().
+// Then it tries to be the combiner by the lock. The combiner collects all pending requests,
+// sorts them by key so the successive searches share the path in the SkipSet, applies them and publishes the results.
+// The other threads spin on their own slots, i.e. no shared cache line bouncing, until the result is ready
+// or the lock is free so one of them becomes the next combiner.
+//
+// So the SkipSet is only touched by one thread at a time and stays in its cache,
+// and the lock is acquired once for a batch, not for each operation.
+// NOTE: the throughput does not scale with the threads, it is the single thread's at best,
+//       the gain is that it does not fall when the threads increase, unlike the CAS based or lock based sets.
+//       For the scaling, check ShardedSkipSet.
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+#include "skipset.h"
+#include "skipset.cc"
+#include "spin_lock.h"
+#include "thread_slot.h"
+#include "contention_manager.h"
+
+namespace sss {
+
+template <class T>
+class FlatCombiningSkipSet {
+private:
+  enum Op : int {
+    kInsert,
+    kErase,
+    kContains,
+  };
+
+  enum State : int {
+    kIdle,
+    kPending,   // posted by the owner, the combiner reads op and key after it
+    kDone,      // written by the combiner, the owner reads result after it
+  };
+
+  // padding to cache line, so a waiter spins on its own line
+  struct alignas(64) Slot {
+    std::atomic<int> state{kIdle};
+    Op op = kContains;
+    bool result = false;
+    T key{};
+  };
+
+public:
+  FlatCombiningSkipSet() = default;
+  FlatCombiningSkipSet(const FlatCombiningSkipSet&) = delete;
+  FlatCombiningSkipSet& operator=(const FlatCombiningSkipSet&) = delete;
+
+  bool insert(const T& key) {
+    return apply(kInsert, key);
+  }
+
+  bool erase(const T& key) {
+    return apply(kErase, key);
+  }
+
+  bool contains(const T& key) const {
+    return apply(kContains, key);
+  }
+
+  // the size after the last batch
+  int size() const {
+    return size_.load(std::memory_order_relaxed);
+  }
+
+  // the average number of requests applied by one combining, i.e. how many lock acquisitions are saved
+  double avg_batch() const {
+    std::lock_guard<SpinLock> lock(lock_);
+    return combines_ == 0 ? 0 : static_cast<double>(combined_) / combines_;
+  }
+
+  // visit all keys in ascending order by visitor(const T& key) under the combiner lock,
+  // so it is a snapshot, but no request is applied until it finishes
+  template <class Visitor>
+  void for_each(Visitor visitor) const {
+    std::lock_guard<SpinLock> lock(lock_);
+    for (auto it = set_.begin(); it != set_.end(); ++it) {
+      visitor(*it);
+    }
+  }
+
+private:
+  // post the request, then either combine or wait for a combiner to finish it
+  bool apply(const Op op, const T& key) const {
+    Slot& slot = slots_[ThreadSlot::id()];
+    slot.op = op;
+    slot.key = key;
+    slot.state.store(kPending, std::memory_order_release);
+
+    while (true) {
+      if (lock_.try_lock()) {
+        combine();    // our request is pending, so it is in the batch
+        lock_.unlock();
+      } else {
+        int spins = 0;
+        while (spins < kWaitSpins && slot.state.load(std::memory_order_acquire) == kPending) {
+          cpu_pause();
+          ++spins;
+        }
+        if (spins == kWaitSpins)
+          std::this_thread::yield();    // the combiner could be preempted, e.g. more threads than cores
+      }
+
+      if (slot.state.load(std::memory_order_acquire) == kDone) {
+        slot.state.store(kIdle, std::memory_order_relaxed);
+        return slot.result;
+      }
+    }
+  }
+
+  // the requests posted during a pass are collected by the next pass, up to kCombinePasses
+  void combine() const {
+    for (int pass = 0; pass < kCombinePasses; ++pass) {
+      batch_.clear();
+      for (int i = 0, hw = ThreadSlot::high_water(); i < hw; ++i) {
+        if (slots_[i].state.load(std::memory_order_acquire) == kPending)
+          batch_.push_back(&slots_[i]);
+      }
+      if (batch_.empty())
+        break;
+
+      // NOTE: the requests of the same key are from different threads and concurrent, so any order is linearizable
+      std::sort(batch_.begin(), batch_.end(), [](const Slot* a, const Slot* b) { return a->key < b->key; });
+      for (Slot* const slot : batch_) {
+        switch (slot->op) {
+        case kInsert:
+          slot->result = set_.insert(slot->key);
+          break;
+        case kErase:
+          slot->result = set_.erase(slot->key);
+          break;
+        case kContains:
+          slot->result = set_.contains(slot->key);
+          break;
+        }
+        slot->state.store(kDone, std::memory_order_release);
+      }
+
+      ++combines_;
+      combined_ += static_cast<int64_t>(batch_.size());
+      size_.store(set_.size(), std::memory_order_relaxed);
+    }
+  }
+
+private:
+  static constexpr int kCombinePasses = 3;
+  static constexpr int kWaitSpins = 256;
+
+  // all mutable because contains() const posts a request too, they are only changed by the combiner under lock_,
+  // except the slots which are changed by their owners
+  mutable Slot slots_[ThreadSlot::kMaxThreads];
+  alignas(64) mutable SpinLock lock_;
+  mutable SkipSet<T> set_;
+  mutable std::vector<Slot*> batch_;
+  mutable int64_t combines_ = 0;
+  mutable int64_t combined_ = 0;
+  mutable std::atomic<int> size_{0};
+};
+
+} // namespace sss
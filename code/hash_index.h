@@ -0,0 +1,138 @@
+// hash index of the nodes for the point lookups of LockFreeSkipSet, i.e. contains() in one probe instead of O(log n) levels
+//
+// It is a template parameter of LockFreeSkipSet like the Reclaimer and Backoff, and each set owns one Table
+// 1. NoHashIndex (default), no index, no memory and no cost
+// 2. HashIndex<Hash>, a lock-free open addressing table from the key to the level0 node.
+//    The default Hash is std::hash of the key type of the node, e.g. HashIndex<> for LockFreeSkipSet<std::string>
+//
+// The index is a cache of the skip set, not a second copy of it:
+// 1. add() inserts the node after it links the node in level0, and the node is erased before it is retired,
+//    so any node found in the index is safe to visit under the guard of the set.
+// 2. the slot of a node is searched in a window of kProbeLimit slots after the hash. If the window is full,
+//    the node is not indexed, i.e. the index never resizes and never blocks.
+// 3. so a lookup which misses the index, or finds a node flagged as deleted, must search the skip set again.
+//    Only a hit of a node which is not flagged is an answer, because the node is in level0 until it is flagged.
+//
+// The slots only change by null -> node, node -> tombstone and tombstone -> node, i.e. never back to null,
+// so a lookup can stop at the first null slot in the window.
+//
+// NOTE: the memory cost is 8 bytes for each slot, and the slots are allocated in ctor().
+//       Give about 2x slots of the expected keys, otherwise the windows are full and more lookups miss.
+//       A miss costs one more probe than the skip set without the index, e.g. contains() of absent keys.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <functional>
+#include <type_traits>
+
+namespace sss {
+
+class NoHashIndex {
+public:
+  static constexpr bool kEnabled = false;
+
+  template <class Node>
+  class Table {
+  public:
+    explicit Table(const std::size_t) {}
+
+    template <class K>
+    Node* find(const K&) const noexcept { return nullptr; }
+    void insert(Node* const) noexcept {}
+    void erase(Node* const) noexcept {}
+    std::size_t memory_bytes() const noexcept { return 0; }
+  };
+};
+
+// Hash = void means std::hash of the key type, which is only known by Table<Node>
+template <class Hash = void>
+class HashIndex {
+public:
+  static constexpr bool kEnabled = true;
+
+  template <class Node>
+  class Table {
+    using KeyHash = std::conditional_t<std::is_void_v<Hash>, std::hash<std::decay_t<decltype(Node::key)>>, Hash>;
+
+  public:
+    // capacity is rounded up to the power of two, 0 means kDefaultCapacity
+    explicit Table(const std::size_t capacity) {
+      std::size_t cap = kProbeLimit;
+      while (cap < (capacity == 0 ? kDefaultCapacity : capacity))
+        cap <<= 1;
+      mask_ = cap - 1;
+      slots_ = std::make_unique<std::atomic<Node*>[]>(cap);
+      for (std::size_t i = 0; i < cap; ++i)
+        slots_[i].store(nullptr, std::memory_order_relaxed);
+    }
+
+    Table(const Table&) = delete;
+    Table& operator=(const Table&) = delete;
+
+    // any node of the key in the index, or nullptr. The caller checks whether it is flagged
+    // NOTE: acquire pairs with the CAS of insert(), so the key of the node is visible
+    template <class K>
+    Node* find(const K& key) const noexcept {
+      for (std::size_t i = 0, pos = slot_of(key); i < kProbeLimit; ++i, pos = (pos+1) & mask_) {
+        Node* const node = slots_[pos].load(std::memory_order_acquire);
+        if (node == nullptr)
+          return nullptr;
+        if (node != tombstone() && node->key == key)
+          return node;
+      }
+      return nullptr;
+    }
+
+    // best effort, the node is not indexed if the window is full
+    void insert(Node* const node) noexcept {
+      for (std::size_t i = 0, pos = slot_of(node->key); i < kProbeLimit; ++i, pos = (pos+1) & mask_) {
+        Node* slot = slots_[pos].load(std::memory_order_relaxed);
+        while (slot == nullptr || slot == tombstone()) {
+          if (slots_[pos].compare_exchange_weak(slot, node, std::memory_order_release, std::memory_order_relaxed))
+            return;
+        }
+      }
+    }
+
+    // the node is indexed at most once, and only the thread retiring the node erases it
+    void erase(Node* const node) noexcept {
+      for (std::size_t i = 0, pos = slot_of(node->key); i < kProbeLimit; ++i, pos = (pos+1) & mask_) {
+        Node* const slot = slots_[pos].load(std::memory_order_relaxed);
+        if (slot == nullptr)
+          return;
+        if (slot == node) {
+          slots_[pos].store(tombstone(), std::memory_order_relaxed);
+          return;
+        }
+      }
+    }
+
+    std::size_t memory_bytes() const noexcept {
+      return (mask_+1) * sizeof(std::atomic<Node*>);
+    }
+
+  private:
+    // fibonacci hashing, so the keys of an identity hash, e.g. std::hash<int>, are spread too
+    template <class K>
+    std::size_t slot_of(const K& key) const noexcept {
+      const uint64_t h = static_cast<uint64_t>(KeyHash()(key)) * 0x9E3779B97F4A7C15ull;
+      return static_cast<std::size_t>(h >> 32) & mask_;
+    }
+
+    // a fake node address which is never dereferenced
+    static Node* tombstone() noexcept {
+      return reinterpret_cast<Node*>(uintptr_t(1));
+    }
+
+    static constexpr std::size_t kProbeLimit = 16;
+    static constexpr std::size_t kDefaultCapacity = 1 << 16;
+
+    std::unique_ptr<std::atomic<Node*>[]> slots_;
+    std::size_t mask_;
+  };
+};
+
+} // namespace sss
@@ -0,0 +1,134 @@
+// hazard pointer domain for the lock-free containers
+// reference: Maged M. Michael, <<Hazard Pointers: Safe Memory Reclamation for Lock-Free Objects>>
+//
+// Each thread publishes the nodes it is visiting in its hazard slots, e.g. pred and curr in a link list.
+// A node which has been unlinked is retired to the retire list of the thread.
+// When the retire list is long enough, the thread scans the hazard slots of all threads
+// and frees the retired nodes which are not published by any thread.
+// The threshold is proportional to the number of hazard slots, so the cost of a scan is amortized
+// and the number of unfreed nodes is bounded.
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include <cassert>
+
+#include "thread_slot.h"
+#include "memory_order.h"
+
+namespace sss {
+
+class HazardPointerDomain {
+public:
+  static constexpr int kHazardsPerThread = 3;
+  static constexpr bool kNeedValidation = true;   // a node is only safe after protect() and validation
+
+private:
+  struct Retired {
+    void* ptr;
+    void (*deleter)(void*, void*);
+    void* context;
+  };
+
+  // padding to cache line to avoid false sharing between threads
+  struct alignas(64) Record {
+    std::atomic<void*> hazards[kHazardsPerThread] = {};
+    std::vector<Retired> retired;   // only visited by the thread of the slot
+  };
+
+public:
+  // Guard clears all hazard slots of the thread when the operation finishes
+  class Guard {
+  public:
+    explicit Guard(HazardPointerDomain& domain) : record_(&domain.records_[ThreadSlot::id()]) {}
+
+    ~Guard() noexcept {
+      for (auto& hazard : record_->hazards) {
+        hazard.store(nullptr, std::memory_order_release);
+      }
+    }
+
+    Guard(const Guard&) = delete;
+    Guard& operator=(const Guard&) = delete;
+
+    // publish ptr in the slot of index.
+    // NOTE: the caller must validate that ptr is still reachable after protect(),
+    //       only after that the caller can safely dereference ptr
+    void protect(const int index, void* const ptr) noexcept {
+      assert(index >= 0 && index < kHazardsPerThread);
+      // the store must be visible before the validation load which could be acquire only, check memory_order.h
+      record_->hazards[index].store(ptr, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+  private:
+    Record* record_;
+  };
+
+public:
+  HazardPointerDomain() = default;
+
+  // when dtor(), no thread can be visiting the container, so all retired nodes can be freed
+  ~HazardPointerDomain() noexcept {
+    for (auto& record : records_) {
+      for (const auto& retired : record.retired) {
+        retired.deleter(retired.ptr, retired.context);
+      }
+    }
+  }
+
+  HazardPointerDomain(const HazardPointerDomain&) = delete;
+  HazardPointerDomain& operator=(const HazardPointerDomain&) = delete;
+
+  // a thread is quiescent whenever it has no hazard published, so nothing to do
+  void quiescent() noexcept {}
+
+  void offline() noexcept {}
+
+  // ptr must have been unlinked, i.e. no new reference to it can be acquired from now on.
+  // deleter(ptr, context) is called when no thread publishes ptr in its hazard slots
+  void retire(void* const ptr, void (*deleter)(void*, void*), void* const context = nullptr) {
+    auto& record = records_[ThreadSlot::id()];
+    record.retired.push_back({ptr, deleter, context});
+
+    const int threshold = kScanBase + 2 * kHazardsPerThread * ThreadSlot::high_water();
+    if (static_cast<int>(record.retired.size()) >= threshold)
+      scan(record);
+  }
+
+private:
+  void scan(Record& record) {
+    store_load_fence();   // the unlinks of the retired nodes must be visible before reading the hazards
+
+    std::vector<void*> hazards;
+    hazards.reserve(kHazardsPerThread * ThreadSlot::high_water());
+    for (int i = 0, hw = ThreadSlot::high_water(); i < hw; ++i) {
+      for (const auto& hazard : records_[i].hazards) {
+        void* const ptr = hazard.load();
+        if (ptr != nullptr)
+          hazards.push_back(ptr);
+      }
+    }
+    std::sort(hazards.begin(), hazards.end());
+
+    auto& retired = record.retired;
+    std::size_t keep = 0;
+    for (std::size_t i = 0; i < retired.size(); ++i) {
+      if (std::binary_search(hazards.begin(), hazards.end(), retired[i].ptr)) {
+        retired[keep++] = retired[i];   // still visited by some thread, try next time
+      } else {
+        retired[i].deleter(retired[i].ptr, retired[i].context);
+      }
+    }
+    retired.resize(keep);
+  }
+
+private:
+  static constexpr int kScanBase = 64;
+
+  Record records_[ThreadSlot::kMaxThreads];
+};
+
+} // namespace sss
@@ -0,0 +1,319 @@
+// lazy skip set, i.e. the optimistic lock-based concurrent skip list
+// reference: Maurice Herlihy, Yossi Lev, Victor Luchangco, Nir Shavit, <<A Simple Optimistic Skiplist Algorithm>>
+//            and <<The Art of Multiprocessor Programming>>, chapter 14.3
+//
+// Compared to LockFreeSkipSet, which CASes each level of a tower when adding and flags each level when removing,
+// a writer here searches without locks, then locks only the preds of the levels it changes (and the victim for remove()),
+// validates them, and links or unlinks with plain release stores under the locks.
+// So a write is a few lock acquisitions on distinct nodes, and the links have no flag bits.
+//
+// Two flags of a node make contains() wait-free, it never locks and never retries
+// 1. fully_linked, set by add() after all levels are linked, the linearization point of a successful add()
+// 2. marked, set by remove() under the lock of the victim before unlinking, the linearization point of a successful remove()
+// A key is in the set iff its node is found in level0 which is fully_linked and not marked.
+//
+// The locks are always acquired in descending order of the keys, i.e. the victim first then the preds from level0 up,
+// and a pred in a higher level is not bigger than the one below it, so there is no deadlock.
+//
+// Reclaimer is the same as LockFreeSkipSet, an unlinked node is retired because a concurrent search could be on it.
+
+#pragma once
+
+#include <atomic>
+#include <iostream>
+#include <climits>
+#include <new>
+#include <cassert>
+
+#include "spin_lock.h"
+#include "memory_order.h"
+#include "epoch_reclaimer.h"
+#include "qsbr_reclaimer.h"
+#include "leak_reclaimer.h"
+#include "node_pool.h"
+#include "thread_random.h"
+#include "striped_counter.h"
+#include "contention_manager.h"
+
+namespace sss {
+
+template <class T, class Reclaimer = EpochReclaimer>
+class LazySkipSet {
+  static_assert(!Reclaimer::kNeedValidation, "LazySkipSet does not support reclaimer which needs validation");
+
+private:
+  // the links of all levels are allocated in place after the node like LockFreeSkipSet::Node, check NodePool
+  struct Node {
+    T key;
+    const int height;
+    std::atomic<bool> marked;
+    std::atomic<bool> fully_linked;
+    SpinLock lock;
+    std::atomic<Node*> nexts[1];    // NOTE: the real size is height
+
+    static std::size_t size_of(const int height) {
+      return sizeof(Node) + (height-1)*sizeof(std::atomic<Node*>);
+    }
+
+    static Node* construct(void* const mem, const int height) {
+      assert(height > 0);
+      return new (mem) Node(height);
+    }
+
+    static void destroy(Node* const node) noexcept {
+      node->~Node();
+    }
+
+    // a node from NodePool could be recycled, reset it to be a new one
+    void reset(const T& k) {
+      key = k;
+      marked.store(false, std::memory_order_relaxed);
+      fully_linked.store(false, std::memory_order_relaxed);
+      for (int level = 0; level < height; ++level) {
+        nexts[level].store(nullptr, std::memory_order_relaxed);
+      }
+    }
+
+  private:
+    explicit Node(const int h) : key(), height(h), marked(false), fully_linked(false), nexts{nullptr} {
+      for (int level = 1; level < height; ++level) {
+        new (&nexts[level]) std::atomic<Node*>(nullptr);
+      }
+    }
+
+    ~Node() noexcept = default;
+  };
+
+public:
+  LazySkipSet() : height_(1), size_(kSizeFoldThreshold), pool_(kMaxHeight) {
+    head_ = pool_.acquire(kMaxHeight);
+    tail_ = pool_.acquire(kMaxHeight);
+    for (int level = 0; level < kMaxHeight; ++level) {
+      head_->nexts[level].store(tail_, std::memory_order_relaxed);
+    }
+    head_->fully_linked.store(true, std::memory_order_relaxed);
+    tail_->fully_linked.store(true, std::memory_order_relaxed);
+  }
+
+  // no thread can visit the set when dtor(), all nodes are freed by pool_,
+  // and reclaimer_ returns the retired nodes to pool_ before that
+  ~LazySkipSet() noexcept = default;
+
+  LazySkipSet(const LazySkipSet&) = delete;
+  LazySkipSet& operator=(const LazySkipSet&) = delete;
+
+  int size(const SizeMode mode = SizeMode::kExact) const {
+    const auto size = mode == SizeMode::kExact ? size_.sum() : size_.approximate();
+    return static_cast<int>(std::max<int64_t>(size, 0));
+  }
+
+  bool empty() const {
+    return size() == 0;
+  }
+
+  // check QsbrReclaimer
+  void quiescent() {
+    reclaimer_.quiescent();
+  }
+
+  void offline() {
+    reclaimer_.offline();
+  }
+
+  // If the key is found and not marked, wait until it is fully linked, then return false,
+  // because the add() of that node has not returned yet but its key must be in the set after our return.
+  // If it is marked, it is being removed, so retry until it is unlinked.
+  // Otherwise lock the preds of the levels of the new node, validate that each pred is not marked
+  // and still links to its succ which is not marked, then link the new node bottom up and set fully_linked.
+  bool add(const T& key) {
+    typename Reclaimer::Guard guard(reclaimer_);
+    Node* preds[kMaxHeight];
+    Node* succs[kMaxHeight];
+    const int top_height = random_height();
+    raise_height(top_height);
+
+    while (true) {
+      const int found_level = find(key, preds, succs);
+      if (found_level != -1) {
+        Node* const found = succs[found_level];
+        if (!found->marked.load(std::memory_order_acquire)) {
+          while (!found->fully_linked.load(std::memory_order_acquire))
+            cpu_pause();
+          return false;
+        }
+        continue;
+      }
+
+      int locked_height = 0;
+      const bool valid = lock_preds(preds, top_height, locked_height, [&succs](Node* const pred, const int level) {
+        Node* const succ = succs[level];
+        return !succ->marked.load(std::memory_order_acquire) &&
+               pred->nexts[level].load(std::memory_order_acquire) == succ;
+      });
+      if (!valid) {
+        unlock_preds(preds, locked_height);
+        continue;
+      }
+
+      Node* const new_node = pool_.acquire(top_height);
+      new_node->reset(key);
+      for (int level = 0; level < top_height; ++level) {
+        new_node->nexts[level].store(succs[level], std::memory_order_relaxed);
+      }
+      for (int level = 0; level < top_height; ++level) {
+        preds[level]->nexts[level].store(new_node, std::memory_order_release);
+      }
+      new_node->fully_linked.store(true, std::memory_order_release);
+      unlock_preds(preds, locked_height);
+      size_.add(1);
+      return true;
+    }
+  }
+
+  // The victim must be fully linked, not marked, and found at its top level,
+  // otherwise it is a node being added or removed by others, or not the node of the key in that level.
+  // Lock the victim and mark it, then lock the preds and validate that each pred is not marked and links to the victim,
+  // then unlink the victim top down. If the validation fails, keep the victim marked and retry the preds.
+  bool remove(const T& key) {
+    typename Reclaimer::Guard guard(reclaimer_);
+    Node* preds[kMaxHeight];
+    Node* succs[kMaxHeight];
+    Node* victim = nullptr;
+
+    while (true) {
+      const int found_level = find(key, preds, succs);
+      if (victim == nullptr) {
+        if (found_level == -1)
+          return false;
+
+        Node* const candidate = succs[found_level];
+        if (!candidate->fully_linked.load(std::memory_order_acquire) ||
+            candidate->height-1 != found_level || candidate->marked.load(std::memory_order_acquire))
+          return false;
+
+        candidate->lock.lock();
+        if (candidate->marked.load(std::memory_order_relaxed)) {
+          candidate->lock.unlock();
+          return false;   // another remover marked it first
+        }
+        candidate->marked.store(true, std::memory_order_release);
+        victim = candidate;
+      }
+
+      int locked_height = 0;
+      const bool valid = lock_preds(preds, victim->height, locked_height, [victim](Node* const pred, const int level) {
+        return pred->nexts[level].load(std::memory_order_acquire) == victim;
+      });
+      if (!valid) {
+        unlock_preds(preds, locked_height);
+        continue;
+      }
+
+      for (int level = victim->height-1; level >= 0; --level) {
+        preds[level]->nexts[level].store(victim->nexts[level].load(std::memory_order_relaxed), std::memory_order_release);
+      }
+      victim->lock.unlock();
+      unlock_preds(preds, locked_height);
+      size_.add(-1);
+      reclaimer_.retire(victim, recycle_node, &pool_);
+      return true;
+    }
+  }
+
+  // wait-free, no lock and no retry
+  bool contains(const T& key) const {
+    typename Reclaimer::Guard guard(reclaimer_);
+    Node* pred = head_;
+    for (int level = height_.load(std::memory_order_acquire)-1; level >= 0; --level) {
+      Node* curr = pred->nexts[level].load(std::memory_order_acquire);
+      while (curr != tail_ && curr->key < key) {
+        pred = curr;
+        curr = pred->nexts[level].load(std::memory_order_acquire);
+      }
+      if (curr != tail_ && curr->key == key)
+        return curr->fully_linked.load(std::memory_order_acquire) && !curr->marked.load(std::memory_order_acquire);
+    }
+    return false;
+  }
+
+private:
+  // search without lock from the top, fill preds and succs of all levels below height_ where preds[i] < key <= succs[i].
+  // Return the highest level where succs[level] is the key, or -1 if not found
+  int find(const T& key, Node* preds[], Node* succs[]) const {
+    int found_level = -1;
+    Node* pred = head_;
+    for (int level = height_.load(std::memory_order_acquire)-1; level >= 0; --level) {
+      Node* curr = pred->nexts[level].load(std::memory_order_acquire);
+      while (curr != tail_ && curr->key < key) {
+        pred = curr;
+        curr = pred->nexts[level].load(std::memory_order_acquire);
+      }
+      if (found_level == -1 && curr != tail_ && curr->key == key)
+        found_level = level;
+      preds[level] = pred;
+      succs[level] = curr;
+    }
+    return found_level;
+  }
+
+  // lock the distinct preds of levels [0, height) bottom up, and validate each level by
+  // !pred->marked && valid(pred, level) after locking it. Stop at the first invalid level.
+  // locked_height is the levels whose pred is locked, for unlock_preds()
+  template <class Valid>
+  bool lock_preds(Node* preds[], const int height, int& locked_height, Valid valid) const {
+    Node* prev_pred = nullptr;
+    for (int level = 0; level < height; ++level) {
+      Node* const pred = preds[level];
+      if (pred != prev_pred) {
+        pred->lock.lock();
+        prev_pred = pred;
+      }
+      locked_height = level+1;
+      if (pred->marked.load(std::memory_order_acquire) || !valid(pred, level))
+        return false;
+    }
+    return true;
+  }
+
+  // a pred of many levels is locked once, so unlock it once
+  void unlock_preds(Node* preds[], const int locked_height) const {
+    Node* prev_pred = nullptr;
+    for (int level = 0; level < locked_height; ++level) {
+      if (preds[level] != prev_pred) {
+        preds[level]->lock.unlock();
+        prev_pred = preds[level];
+      }
+    }
+  }
+
+  // check LockFreeSkipSet::raise_height()
+  void raise_height(const int top_height) {
+    int height = height_.load(std::memory_order_relaxed);
+    while (height < top_height) {
+      if (height_.compare_exchange_weak(height, top_height, std::memory_order_release, std::memory_order_relaxed))
+        break;
+    }
+  }
+
+  int random_height() const {
+    return ThreadRandom::geometric_height(kMaxHeight);
+  }
+
+  static void recycle_node(void* const node, void* const pool) {
+    auto* const n = static_cast<Node*>(node);
+    static_cast<NodePool<Node>*>(pool)->release(n, n->height);
+  }
+
+private:
+  static constexpr int kMaxHeight = 32;
+  static constexpr int64_t kSizeFoldThreshold = 32;
+
+  Node* head_;
+  Node* tail_;
+  std::atomic<int> height_;
+  StripedCounter size_;
+  NodePool<Node> pool_;          // NOTE: pool_ must be destroyed after reclaimer_ which returns nodes to it
+  mutable Reclaimer reclaimer_;  // mutable because contains() const needs a guard
+};
+
+} // namespace sss
@@ -0,0 +1,61 @@
+// leak reclaimer keeps all retired nodes until the container is destroyed,
+// which is the behaviour of the lock-free containers before they had memory reclamation.
+// It is the baseline for benchmarking the other reclaimers,
+// or for the app which only adds keys or whose container lives shortly.
+
+#pragma once
+
+#include <vector>
+
+#include "thread_slot.h"
+
+namespace sss {
+
+class LeakReclaimer {
+public:
+  static constexpr bool kNeedValidation = false;
+
+  class Guard {
+  public:
+    explicit Guard(LeakReclaimer&) noexcept {}
+
+    void protect(const int, void* const) noexcept {}
+  };
+
+public:
+  LeakReclaimer() = default;
+
+  ~LeakReclaimer() noexcept {
+    for (auto& record : records_) {
+      for (const auto& retired : record.retired) {
+        retired.deleter(retired.ptr, retired.context);
+      }
+    }
+  }
+
+  LeakReclaimer(const LeakReclaimer&) = delete;
+  LeakReclaimer& operator=(const LeakReclaimer&) = delete;
+
+  void quiescent() noexcept {}
+
+  void offline() noexcept {}
+
+  void retire(void* const ptr, void (*deleter)(void*, void*), void* const context = nullptr) {
+    records_[ThreadSlot::id()].retired.push_back({ptr, deleter, context});
+  }
+
+private:
+  struct Retired {
+    void* ptr;
+    void (*deleter)(void*, void*);
+    void* context;
+  };
+
+  struct alignas(64) Record {
+    std::vector<Retired> retired;
+  };
+
+  Record records_[ThreadSlot::kMaxThreads];
+};
+
+} // namespace sss
@@ -0,0 +1,459 @@
+// lock-free doubly linked ordered set, check Lock-free-double-linked-list.pdf in the root of the repo,
+// and <<Lock-free deques and doubly linked lists>> by Hakan Sundell and Philippas Tsigas
+//
+// Like LockFreeSetLinkList, the next links are the truth of the set,
+// i.e. a key is in the set iff its node is linked by next and the next of the node is not flagged as deleted.
+// So add(), remove() and contains() work the same and are linearizable by the CAS of next.
+//
+// The prev links are only hints for going backward. The prev of a node points to a node which was before it
+// at some time, so its key is always less, but it could be deleted or not the nearest one.
+// Going backward from a node, we walk the prev links until a live node,
+// then walk forward by next to the last live node whose key is less than the node's. Check prev_live().
+// The prev links are fixed by best effort
+// 1. add() sets new_node->prev = pred before linking, then succ->prev = new_node if succ->prev is still pred
+// 2. the thread which unlinks curr sets succ->prev = pred if succ->prev is still curr
+// 3. prev_live() sets node->prev to the live node it found
+//
+// A prev link could point to a node which has been unlinked for a long time, so the reclaimer alone is not enough.
+// Each node counts the references to it in refs, check acquire_ref() and release_ref()
+// 1. the link by next, released by the thread which unlinks the node
+// 2. the thread of add(), released after it fixes succ->prev
+// 3. each prev link which points to it
+// When refs drops to zero, no link can reach the node and the node is retired to reclaimer_.
+// A thread in a guard only reads a prev link which holds a reference, so the node it points to is safe to visit.
+//
+// Cursor is a position in the list, which can move forward and backward, and insert or erase at the position.
+// An edit at a cursor searches from the cursor instead of head_, so it is O(1) for a local edit.
+
+#pragma once
+
+#include <iostream>
+#include <climits>
+#include <tuple>
+
+#include "atomic_flag_reference.h"
+#include "memory_order.h"
+#include "epoch_reclaimer.h"
+#include "qsbr_reclaimer.h"
+#include "leak_reclaimer.h"
+#include "striped_counter.h"
+
+namespace sss {
+
+// Reclaimer is the policy of memory reclamation for the dead nodes, which could be
+// 1. EpochReclaimer (default), each operation enters an epoch guard
+// 2. QsbrReclaimer, zero overhead for operations, but each thread must call quiescent() regularly
+// 3. LeakReclaimer, keep all dead nodes until dtor()
+// NOTE: HazardPointerDomain is not supported, because the traversal by prev links does not validate the nodes
+template <class T, class Reclaimer = EpochReclaimer>
+class LockFreeDoubleLinkList {
+  static_assert(!Reclaimer::kNeedValidation, "LockFreeDoubleLinkList does not support reclaimer which needs validation");
+
+private:
+  struct Node {
+    T key;
+    FlagReference<Node> next;
+    std::atomic<Node*> prev;  // hint, nullptr when the node is dead. check release_ref()
+    std::atomic<int> refs;    // the link by next and the thread of add(), check add_from()
+
+    Node(const T& k) : key(k), next(nullptr, false), prev(nullptr), refs(2) {}
+  };
+
+public:
+  // NOTE: a cursor holds a guard like LockFreeSkipSet::Iterator, so do not keep it when calling quiescent().
+  //       The node of a cursor could be removed by other threads, then the cursor can still move and insert,
+  //       but *cursor is a key which is not in the set.
+  class Cursor {
+  public:
+    Cursor(Node* node, LockFreeDoubleLinkList& list) : node_(node), list_(&list), guard_(list.reclaimer_) {
+      assert(node != nullptr);
+    }
+    ~Cursor() noexcept = default;
+    Cursor(const Cursor& copy) = default;
+    Cursor& operator=(const Cursor& rhs) = default;
+
+    // false if the cursor is before the first node or after the last node
+    bool valid() const {
+      return node_ != list_->head_ && node_ != list_->tail_;
+    }
+
+    T operator*() const {
+      assert(valid());
+      return node_->key;
+    }
+
+    // to the next live node, or after the last node
+    Cursor& operator++() {
+      assert(node_ != list_->tail_);
+      node_ = list_->next_live(node_);
+      return *this;
+    }
+
+    // to the previous live node, or before the first node
+    Cursor& operator--() {
+      assert(node_ != list_->head_);
+      node_ = list_->prev_live(node_);
+      return *this;
+    }
+
+    bool operator==(const Cursor& rhs) const {
+      return node_ == rhs.node_;
+    }
+
+    bool operator!=(const Cursor& rhs) const {
+      return !((*this) == rhs);
+    }
+
+  private:
+    friend class LockFreeDoubleLinkList;
+
+    Node* node_;
+    LockFreeDoubleLinkList* list_;
+    typename Reclaimer::Guard guard_;
+  };
+
+public:
+  LockFreeDoubleLinkList() : head_(new Node(T())), tail_(new Node(T())), size_(kSizeFoldThreshold) {
+    head_->next.set_ref(tail_);
+    tail_->prev.store(head_);
+  }
+
+  // when dtor(), it needs the app to guarantee no thread is visiting the list.
+  // The linked nodes, flagged or not, are deleted here.
+  // Their prev links are released first, which could retire the unlinked nodes to reclaimer_ which frees them
+  ~LockFreeDoubleLinkList() noexcept {
+    for (Node* curr = head_->next.get_ref(); curr != tail_; curr = curr->next.get_ref()) {
+      curr->refs.store(kLinkedInDtor);   // so releasing the prev links can not retire them
+    }
+    release_ref(tail_->prev.exchange(nullptr));
+    for (Node* curr = head_->next.get_ref(); curr != tail_; curr = curr->next.get_ref()) {
+      release_ref(curr->prev.exchange(nullptr));
+    }
+
+    Node* curr = head_->next.get_ref();
+    while (curr != tail_) {
+      Node* const next = curr->next.get_ref();
+      delete curr;
+      curr = next;
+    }
+    delete head_;
+    delete tail_;
+  }
+
+  LockFreeDoubleLinkList(const LockFreeDoubleLinkList&) = delete;
+  LockFreeDoubleLinkList& operator=(const LockFreeDoubleLinkList& rhs) = delete;
+
+  int64_t size(const SizeMode mode = SizeMode::kExact) const {
+    return mode == SizeMode::kExact ? size_.sum() : size_.approximate();
+  }
+
+  bool empty() const {
+    return size() == 0;
+  }
+
+  // the calling thread holds no reference to any node, i.e. no Cursor living. Check QsbrReclaimer
+  void quiescent() {
+    reclaimer_.quiescent();
+  }
+
+  void offline() {
+    reclaimer_.offline();
+  }
+
+  bool add(const T& key) {
+    typename Reclaimer::Guard guard(reclaimer_);
+    return add_from(head_, key) != nullptr;
+  }
+
+  bool remove(const T& key) {
+    typename Reclaimer::Guard guard(reclaimer_);
+    auto [pred, curr] = find(head_, key);
+    if (curr == tail_ || !(curr->key == key))
+      return false;
+
+    return remove_node(pred, curr);
+  }
+
+  // wait-free like LockFreeSetLinkList::contains()
+  bool contains(const T& key) const {
+    typename Reclaimer::Guard guard(reclaimer_);
+    Node* curr = head_->next.get_ref(kReadOrder);
+    while (curr != tail_ && curr->key < key) {
+      curr = curr->next.get_ref(kReadOrder);
+    }
+    return curr != tail_ && curr->key == key && !curr->next.get_flag(kReadOrder);
+  }
+
+  // the cursor of the first key, it is not valid() if the list is empty
+  Cursor first() {
+    typename Reclaimer::Guard guard(reclaimer_);
+    return Cursor(next_live(head_), *this);
+  }
+
+  // the cursor of the last key, it is not valid() if the list is empty
+  Cursor last() {
+    typename Reclaimer::Guard guard(reclaimer_);
+    return Cursor(prev_live(tail_), *this);
+  }
+
+  // the cursor of the first key which is not less than key, it is not valid() if no such key
+  Cursor seek(const T& key) {
+    typename Reclaimer::Guard guard(reclaimer_);
+    Node* curr = head_->next.get_ref(kReadOrder);
+    while (curr != tail_ && (curr->key < key || curr->next.get_flag(kReadOrder))) {
+      curr = curr->next.get_ref(kReadOrder);
+    }
+    return Cursor(curr, *this);
+  }
+
+  // insert key after the cursor, then the cursor moves to the new key.
+  // The key must be bigger than the key of the cursor to keep the order, otherwise return false.
+  // It searches the position from the cursor,
+  // so if the key is bigger than the next key too, it is inserted at the ordered position after the next.
+  // Return false if the key exists.
+  bool insert_after(Cursor& cursor, const T& key) {
+    assert(cursor.list_ == this && cursor.node_ != tail_);
+    if (cursor.node_ != head_ && !(cursor.node_->key < key))
+      return false;
+
+    Node* const new_node = add_from(cursor.node_, key);
+    if (new_node == nullptr)
+      return false;
+    cursor.node_ = new_node;
+    return true;
+  }
+
+  // insert key before the cursor, then the cursor moves to the new key.
+  // The key must be less than the key of the cursor to keep the order, otherwise return false.
+  // It goes backward from the cursor to a node whose key is less than key, then searches the position from there.
+  // Return false if the key exists.
+  bool insert_before(Cursor& cursor, const T& key) {
+    assert(cursor.list_ == this && cursor.node_ != head_);
+    if (cursor.node_ != tail_ && !(key < cursor.node_->key))
+      return false;
+
+    Node* start = prev_live(cursor.node_);
+    while (start != head_ && !(start->key < key)) {
+      start = prev_live(start);
+    }
+
+    Node* const new_node = add_from(start, key);
+    if (new_node == nullptr)
+      return false;
+    cursor.node_ = new_node;
+    return true;
+  }
+
+  // remove the key of the cursor, then the cursor moves to the next key.
+  // Return false if the key has been removed by another thread.
+  bool erase(Cursor& cursor) {
+    assert(cursor.list_ == this && cursor.valid());
+    Node* const node = cursor.node_;
+    const bool removed = remove_node(prev_live(node), node);
+    cursor.node_ = next_live(node);
+    return removed;
+  }
+
+private:
+  // locate [pred, curr] like LockFreeSetLinkList::find(), i.e. pred->key < key <= curr->key and unlink the deleted ones.
+  // The search starts from start, which must be head_ or a node whose key is less than key.
+  // If start is deleted or an unlink fails, restart from head_.
+  std::tuple<Node*, Node*> find(Node* start, const T& key) {
+    int try_fail_cnt = 0;
+
+    while (try_fail_cnt <= kMaxTryCount) {  // if kMaxTryCount == INT_MAX, it is like while (true)
+      Node* pred = start;
+      Node* curr;
+      if (traverse_with_unlink(key, pred, curr))
+        return {pred, curr};
+
+      ++try_fail_cnt;
+      start = head_;
+    }
+
+    std::cerr << "too many failure when unlink in find(), fail times = " << try_fail_cnt << '\n';
+    exit(-1);
+  }
+
+  bool traverse_with_unlink(const T& key, Node*& pred, Node*& curr) {
+    auto [first, pred_deleted] = pred->next.get(kReadOrder);
+    if (pred_deleted)
+      return false;   // NOTE: head_ is never flagged
+
+    curr = first;
+    while (curr != tail_) {
+      auto [succ, curr_deleted] = curr->next.get(kReadOrder);
+      if (curr_deleted) {
+        if (!try_unlink(pred, curr, succ))
+          return false;
+        curr = succ;
+      } else {
+        if (!(curr->key < key))
+          break;
+        pred = curr;
+        curr = succ;
+      }
+    }
+    return true;
+  }
+
+  // check LockFreeSetLinkList::try_unlink(), and the unlinker releases the reference of the link by next
+  bool try_unlink(Node* const pred, Node* const curr, Node* const succ) {
+    assert(curr->next.get_flag());
+
+    if (!pred->next.compare_and_set(curr, succ, false, false, kUnlinkOrder))
+      return false;
+
+    size_.add(-1);
+    cas_prev(succ, curr, pred);   // fix the hint of succ
+    release_ref(curr);
+    return true;
+  }
+
+  // add key by searching from start, return the new node, or nullptr if the key exists
+  // NOTE: new_node is private until it is linked, so its prev and next can be set without CAS
+  Node* add_from(Node* start, const T& key) {
+    int try_fail_cnt = 0;
+    Node* new_node = nullptr;
+
+    while (try_fail_cnt <= kMaxTryCount) {  // if kMaxTryCount == INT_MAX, it is like while (true)
+      auto [pred, curr] = find(start, key);
+
+      if (curr != tail_ && curr->key == key) {
+        if (new_node != nullptr) {
+          release_ref(new_node->prev.load(kPrivateOrder));
+          delete new_node;
+        }
+        return nullptr;
+      }
+
+      if (new_node == nullptr)
+        new_node = new Node(key);
+
+      Node* const old_prev = new_node->prev.load(kPrivateOrder);
+      if (old_prev != pred) {
+        if (!acquire_ref(pred)) {
+          // pred is dead, i.e. it has been unlinked, so retry
+          ++try_fail_cnt;
+          continue;
+        }
+        new_node->prev.store(pred, kPrivateOrder);
+        release_ref(old_prev);
+      }
+      new_node->next.set_ref(curr, kPrivateOrder);
+
+      if (pred->next.compare_and_set(curr, new_node, false, false, kLinkOrder)) {
+        size_.add(1);
+        cas_prev(curr, pred, new_node);   // fix the hint of curr
+        release_ref(new_node);    // the reference of add()
+        return new_node;
+      }
+      ++try_fail_cnt;
+    }
+
+    std::cerr << "too many failure when link in add(), fail times = " << try_fail_cnt << '\n';
+    exit(-1);
+  }
+
+  // flag node like LockFreeSetLinkList::remove(), only the thread flipping the flag removes the key.
+  // Then find() from pred unlinks it. pred could be any node whose key is less than node's, or head_
+  bool remove_node(Node* const pred, Node* const node) {
+    while (true) {
+      auto [succ, deleted] = node->next.get(kReadOrder);
+      if (deleted)
+        return false;   // removed by another thread
+
+      if (node->next.compare_and_set(succ, succ, false, true, kFlagOrder)) {
+        find(pred, node->key);   // unlink
+        return true;
+      }
+    }
+  }
+
+  // the first live node after node, or tail_
+  Node* next_live(Node* const node) const {
+    Node* curr = node->next.get_ref(kReadOrder);
+    while (curr != tail_ && curr->next.get_flag(kReadOrder)) {
+      curr = curr->next.get_ref(kReadOrder);
+    }
+    return curr;
+  }
+
+  // the last live node before node, i.e. its key is less than node's, or head_.
+  // node could be deleted or tail_
+  Node* prev_live(Node* const node) {
+    Node* const hint = node->prev.load(std::memory_order_acquire);
+
+    // walk back over the deleted nodes, NOTE: head_ is never deleted
+    Node* start = hint;
+    while (start != nullptr && start != head_ && start->next.get_flag(kReadOrder)) {
+      start = start->prev.load(std::memory_order_acquire);
+    }
+    if (start == nullptr)
+      start = head_;    // a node on the way is dead, check release_ref()
+
+    // walk forward to the last live node before node
+    Node* pred = start;
+    Node* curr = start->next.get_ref(kReadOrder);
+    while (curr != node && curr != tail_ && (node == tail_ || curr->key < node->key)) {
+      if (!curr->next.get_flag(kReadOrder))
+        pred = curr;
+      curr = curr->next.get_ref(kReadOrder);
+    }
+
+    if (hint != nullptr && hint != pred)
+      cas_prev(node, hint, pred);   // fix the hint of node for the next time
+    return pred;
+  }
+
+  // a reference can only be acquired when refs > 0, because a node with zero refs has been retired
+  bool acquire_ref(Node* const node) {
+    if (node == head_ || node == tail_)
+      return true;    // head_ and tail_ never die
+
+    int refs = node->refs.load(std::memory_order_relaxed);
+    while (refs > 0) {
+      if (node->refs.compare_exchange_weak(refs, refs+1, std::memory_order_relaxed))
+        return true;
+    }
+    return false;
+  }
+
+  // when refs drops to zero, the node is dead, so it releases its prev link and is retired.
+  // The prev is set to nullptr, so cas_prev() can not set the prev of a dead node
+  void release_ref(Node* node) {
+    while (node != nullptr && node != head_ && node != tail_ && node->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      Node* const prev = node->prev.exchange(nullptr, std::memory_order_acq_rel);
+      reclaimer_.retire(node, delete_node);
+      node = prev;
+    }
+  }
+
+  // set node->prev from expected to desired, best effort for the hints
+  void cas_prev(Node* const node, Node* expected, Node* const desired) {
+    if (!acquire_ref(desired))
+      return;
+
+    Node* const old_prev = expected;
+    if (node->prev.compare_exchange_strong(expected, desired, std::memory_order_acq_rel)) {
+      release_ref(old_prev);
+    } else {
+      release_ref(desired);
+    }
+  }
+
+  static void delete_node(void* const node, void*) {
+    delete static_cast<Node*>(node);
+  }
+
+  Node* head_;  // sentinel virtual pointer, which key is less than any nodes
+  Node* tail_;  // sentinel virtual pointer, which key is greater than any nodes
+  StripedCounter size_;
+  const int kMaxTryCount = INT_MAX;
+  static constexpr int64_t kSizeFoldThreshold = 32;
+  static constexpr int kLinkedInDtor = INT_MAX / 2;
+
+  mutable Reclaimer reclaimer_;  // NOTE: must be destroyed after the nodes are released in dtor()
+};
+
+} // namespace sss
@@ -4,13 +4,27 @@
 
 #include <iostream>
 #include <vector>
-#include <mutex>
+#include <climits>
 
 #include "atomic_flag_reference.h"
+#include "memory_order.h"
+#include "hazard_pointer.h"
+#include "epoch_reclaimer.h"
+#include "qsbr_reclaimer.h"
+#include "leak_reclaimer.h"
+#include "striped_counter.h"
+#include "contention_manager.h"
 
 namespace sss {
 
-template<class T>
+// Reclaimer is the policy of memory reclamation for the unlinked nodes, which could be
+// 1. HazardPointerDomain (default), each thread publishes the nodes it visits
+// 2. EpochReclaimer, each operation enters an epoch guard
+// 3. QsbrReclaimer, zero overhead for operations, but each thread must call quiescent() regularly
+// 4. LeakReclaimer, keep all unlinked nodes until dtor()
+// 
+// Backoff is the contention manager applied when a CAS fails, check contention_manager.h
+template<class T, class Reclaimer = HazardPointerDomain, class Backoff = NoBackoff>
 class LockFreeSetLinkList {
 
 private:
@@ -22,8 +36,15 @@ struct Node {
   Node(const T& k) : key(k), next(nullptr, false) {}
 };
 
+// hazard slots used by a thread when traversing, check traverse_with_unlink()
+enum HazardIndex {
+  kHazardPred = 0,
+  kHazardCurr = 1,
+  kHazardSucc = 2,
+};
+
 public:
-  LockFreeSetLinkList() : head_(new Node(T())), tail_(new Node(T())), size_(0) {
+  LockFreeSetLinkList() : head_(new Node(T())), tail_(new Node(T())), size_(kSizeFoldThreshold) {
     head_->next.set_ref(tail_);
   }
 
@@ -33,6 +54,7 @@ public:
   // 1. delete the node for multi times 
   // 2. can miss some just added nodes which leads to memory leakage
   // it also make those nodes being freed but concurrent thread try to visit them, i.e. dangling potiner
+  // NOTE: the unlinked nodes are freed by reclaimer_
   ~LockFreeSetLinkList() noexcept {
     delete_all_nodes();
 
@@ -70,16 +92,21 @@ private:
   // 
   // find() guarantee that [pred, curr] is not logically deleted from the eye of the caller thread
   // but in concurrent environment, other threads could logically mark pred or curr to be deleted at the same time
-  std::tuple<Node*, Node*> find(const T& key) {
+  // 
+  // when return, pred and curr are protected by the guard, 
+  // so the caller can visit them safely until the guard is destroyed
+  std::tuple<Node*, Node*> find(const T& key, typename Reclaimer::Guard& guard) const {
     int try_fail_cnt = 0;
+    Backoff backoff;
     Node* pred;
     Node* curr;
 
     while (try_fail_cnt <= kMaxTryCount) {  // if kMaxTryCount == INT_MAX, it is like while (true)
-      if (traverse_with_unlink(key, pred, curr)) {
+      if (traverse_with_unlink(key, pred, curr, guard)) {
         return {pred, curr};
       } else {
         ++try_fail_cnt;
+        backoff.fail();
       }
     }
 
@@ -90,12 +117,27 @@ private:
   // From head_ we traverse with unlink the logically delete nodes
   // After locating the [pred, curr], return true.
   // If unlink failed, return false 
-  bool traverse_with_unlink(const T& key, Node*& pred, Node*& curr) {
+  // 
+  // Before dereferencing a node, it must be published in a hazard slot and be validated as reachable,
+  // otherwise it could be freed by another thread between the load and the publication.
+  // 1. curr is safe if after publishing it, pred is still not flagged and pred->curr.
+  //    NOTE: pred is safe because it has been validated in the previous step (or it is head_)
+  // 2. succ is safe if after publishing it, curr->succ is unchanged and curr is still safe by 1.
+  // If validation fails, return false too and the caller find() restarts from head_
+  // NOTE: only hazard pointers need the validation, protect() does nothing for other reclaimers
+  bool traverse_with_unlink(const T& key, Node*& pred, Node*& curr, typename Reclaimer::Guard& guard) const {
     pred = head_;
-    curr = pred->next.get_ref();
+    curr = pred->next.get_ref(kReadOrder);
+    guard.protect(kHazardCurr, curr);
+    if (Reclaimer::kNeedValidation && pred->next.get_ref(kReadOrder) != curr)
+      return false;   // NOTE: head_ is never flagged
 
     while (curr != tail_) {
-      auto [succ, curr_logic_delete] = curr->next.get();
+      auto [succ, curr_logic_delete] = curr->next.get(kReadOrder);
+      guard.protect(kHazardSucc, succ);
+      if (Reclaimer::kNeedValidation && 
+          (!is_same_link(curr, succ, curr_logic_delete) || !is_same_link(pred, curr, false)))
+        return false;   // validation fails
 
       if (curr_logic_delete) {
         if (!try_unlink(pred, curr, succ))
@@ -104,19 +146,28 @@ private:
         // curr has been unlinked successfully, 
         // so curr needs to be the next one and test logical deleted again
         curr = succ;   
+        guard.protect(kHazardCurr, curr);
 
       } else {
         if (curr == tail_ || curr->key >= key) 
           break;
         
         pred = curr;
+        guard.protect(kHazardPred, pred);
         curr = succ;
+        guard.protect(kHazardCurr, curr);
       }
     }
 
     return true;
   }
 
+  // check node->next is still (ref, flag)
+  bool is_same_link(Node* const node, Node* const ref, const bool flag) const noexcept {
+    auto [now_ref, now_flag] = node->next.get(kReadOrder);
+    return now_ref == ref && now_flag == flag;
+  }
+
   // try to phisically delete the node curr, i.e. unlink.
   // before unlink, curr is logically deleted (and could has been unlinked at the same time by another thread), 
   //                i.e. flag is true, which is guaranteed by the caller 
@@ -149,30 +200,20 @@ private:
   //        it will guaratee that 
   //        1. make add() to fail to insert nodes between [pred, curr]
   //        2. make remove() to fail to remove succ 
-  bool try_unlink(Node* const pred, Node* const curr, Node* const succ) noexcept {
+  bool try_unlink(Node* const pred, Node* const curr, Node* const succ) const noexcept {
     assert(curr->next.get_flag());  // must be in logically delete. NOTE: all algorithm guarantee 0->1 for flag, no reverse
     
-    const bool unlink_success = pred->next.compare_and_set(curr, succ, false, false);
+    const bool unlink_success = pred->next.compare_and_set(curr, succ, false, false, kUnlinkOrder);
 
     if (unlink_success) {
-      // TODO: gc
       // because only one thread can call CAS successfully, it is safe to recycle the node
-      // we can add it to gc queue for which 
-      // the thread of guarbage collector will delete it later and safely
-      // we can not delete curr right now, because some concurrent thread maybe visit it at the same time 
-
-      // here we try use mutex for a queue to save the unlinked node
-      // mutex is not lock free, but new, delete is not lock-free too
-      // considering the unlink operation is less than other, the possibility of contention would be low
-      // we will reclaim the memory in lock-free-set-link-list dtor(), so memory consumption need to be considered
-      // another un-safe but effiecient way is tag a timestamp to unlinked node 
-      // and recycle the nodes which last a enough safe long time (like seconds or minutes)
-
-      std::lock_guard<std::mutex> guard(gc_mutex_);
-      gc_nodes_.push_back(curr);      
-
-      assert(size_.load() > 0);
-      --size_;  
+      // we can not delete curr right now, because some concurrent thread maybe visit it at the same time,
+      // so retire it to the reclaimer which frees it when no thread can visit it
+      reclaimer_.retire(curr, delete_node);
+
+      // NOTE: size_ could be negative for a moment, 
+      // because the concurrent add() increases size_ after the node is linked and could be unlinked here
+      size_.add(-1);
     }
 
     return unlink_success; 
@@ -206,19 +247,22 @@ public:
   //
   // if CAS failed, we will repeat to try again  
   bool add(const T& key) {
+    typename Reclaimer::Guard guard(reclaimer_);
     int try_fail_cnt = 0;
+    Backoff backoff;
 
     while (try_fail_cnt <= kMaxTryCount) {  // if kMaxTryCount == INT_MAX, it is like while (true)
-      auto [pred, curr] = find(key);
+      auto [pred, curr] = find(key, guard);
 
-      if (curr->key == key)
+      if (curr != tail_ && curr->key == key)
         return false;
 
       if (try_add(key, pred, curr)) {
-        ++size_;
+        size_.add(1);
         return true;
       } else {
         ++try_fail_cnt;
+        backoff.fail();
       }
     }
 
@@ -229,55 +273,82 @@ public:
   // For remove(), we first call find() to locate [pred, curr]
   // if curr is not the key, return false, i.e., we must find the key first
   // 
-  // otherwise, we will try to use CAS to unlink curr
+  // otherwise, we will try to use CAS to flag curr as logically deleted, 
+  // only the thread which flips the flag from false to true removes the key and returns true.
+  // NOTE: set_flag() is not enough, because two removers could both flag curr,
+  //       and then find() of a third thread unlinks it, so none of the removers could unlink it and return true.
   // 
-  // if CAS failed, it means one of the scenarios happens
-  // 1. curr has been unlinked by another concurrent thread, it could be another thread call remove() or find()
-  // 2. pred not point to curr, because some nodes added before curr, this must happend before curr->next.set_flag(true);
-  // 3. pred not point to curr, because pred is logically deleted, some concurrent thread call remove but locate for pred will make it happen
-  // 4. pred not point to curr, because pred is unlinked. 
+  // if the flag CAS failed, it means one of the scenarios happens
+  // 1. curr has been flagged by another concurrent thread, so next find() will unlink it and return false
+  // 2. curr->succ has been changed, e.g. a node added after curr, so retry by starting by find() which start from head_
   // 
-  // if CAS fail, we will retry by starting by find() which start from head_
+  // After flagging, we try to unlink curr once. If it fails, find() of any thread will unlink it later.
   bool remove(const T& key) {
+    typename Reclaimer::Guard guard(reclaimer_);
     int try_fail_cnt = 0;
+    Backoff backoff;
 
     while (try_fail_cnt <= kMaxTryCount) {  // if kMaxTryCount == INT_MAX, it is like while (true)
-      auto [pred, curr] = find(key);
+      auto [pred, curr] = find(key, guard);
 
-      if (curr->key != key)
+      if (curr == tail_ || curr->key != key)   // NOTE: tail_ has a key of T() which could be equal to key
         return false;
     
-      curr->next.set_flag(true);    // flag curr to be logically deleted
-      auto* succ = curr->next.get_ref();
+      auto* succ = curr->next.get_ref(kReadOrder);
 
-      if (try_unlink(pred, curr, succ)) {
+      // flag curr to be logically deleted
+      if (curr->next.compare_and_set(succ, succ, false, true, kFlagOrder)) {
+        try_unlink(pred, curr, succ);
         return true;
       } else {
         ++try_fail_cnt;
+        backoff.fail();
       }
     }
 
-    std::cerr << "too many failure when try_unlink in remove(), fail times = " << try_fail_cnt << '\n';
+    std::cerr << "too many failure when flag in remove(), fail times = " << try_fail_cnt << '\n';
     exit(-1);
   }
 
   // contains traverse like find() but do no unlink work
   // this way it guaratees wait-free buecause no CAS
+  // NOTE: with hazard pointers the validation of pred fails when pred is flagged and not unlinked, 
+  //       so contains() must help to unlink like find() or it could restart forever.
+  //       The unlinking does not change the keys of the set, so contains() is still const, check reclaimer_
   bool contains(const T& key) const {
-    auto* curr = head_->next.get_ref();
+    typename Reclaimer::Guard guard(reclaimer_);
+    
+    if constexpr (Reclaimer::kNeedValidation) {
+      auto [pred, curr] = find(key, guard);
+      return curr != tail_ && curr->key == key && !curr->next.get_flag(kReadOrder);
+    }
+
+    auto* curr = head_->next.get_ref(kReadOrder);
 
     while (curr != tail_) {
       if (curr->key >= key) 
         break;
 
-      curr = curr->next.get_ref();
+      curr = curr->next.get_ref(kReadOrder);
     }
 
-    return curr != tail_ && curr->key == key && !curr->next.get_flag();   // curr can not be mark as deleted
+    return curr != tail_ && curr->key == key && !curr->next.get_flag(kReadOrder);   // curr can not be mark as deleted
+  }
+
+  // the calling thread holds no reference to any node. Check QsbrReclaimer
+  void quiescent() {
+    reclaimer_.quiescent();
   }
 
-  int size() {
-    return size_;
+  // the calling thread will not visit the list for a long time. Check QsbrReclaimer
+  void offline() {
+    reclaimer_.offline();
+  }
+
+  // the exact size aggregates the counter stripes of all threads, the approximate one is O(1). Check StripedCounter
+  int size(const SizeMode mode = SizeMode::kExact) const {
+    const auto size = mode == SizeMode::kExact ? size_.sum() : size_.approximate();
+    return static_cast<int>(std::max<int64_t>(size, 0));
   }
 
   void debug_print_whole_nodes() {
@@ -304,7 +375,8 @@ public:
   }
 
   bool debug_find(const T& key) {
-    auto [pred, curr] = find(key);
+    typename Reclaimer::Guard guard(reclaimer_);
+    auto [pred, curr] = find(key, guard);
     if (curr != tail_ && curr->key == key) {
       return true;
     } else {
@@ -314,7 +386,7 @@ public:
 
   void debug_print() {
     std::cout << "Lock free set link list debug report. NOTE: if concurrent, the following data would look strange!\n";
-    std::cout << "size = " << size_ << '\n';
+    std::cout << "size = " << size() << '\n';
     debug_print_whole_nodes();
   }
 
@@ -336,22 +408,17 @@ private:
   bool try_link(Node* const new_node, Node* const pred, Node* const curr) {
     assert(new_node->next.get_flag() == false);
 
-    new_node->next.set_ref(curr);
+    new_node->next.set_ref(curr, kPrivateOrder);
 
-    const bool success = pred->next.compare_and_set(curr, new_node, false, false);
+    const bool success = pred->next.compare_and_set(curr, new_node, false, false, kLinkOrder);
     return success;
   }
 
-  void gc_clear() {
-    std::lock_guard<std::mutex> guard(gc_mutex_);
-    for (const auto node : gc_nodes_) {
-      delete node;
-    }
+  static void delete_node(void* const node, void*) {
+    delete static_cast<Node*>(node);
   }
 
   void delete_all_nodes() {
-    gc_clear();
-
     auto* curr = head_->next.get_ref();
     while (curr != tail_) {
       const auto next_ref = curr->next.get_ref();
@@ -362,11 +429,12 @@ private:
 
   Node* head_;  // sentinel virtual pointer, which key is less than any nodes
   Node* tail_;  // sentinel virtual pointer, which key is greater than any nodes
-  std::atomic<int> size_;  // only count nodes exclude unlink nodes, i.e., if logically deleted, they will be counted into size_
+  mutable StripedCounter size_;  // only count nodes exclude unlink nodes, i.e., if logically deleted, they will be counted into size_
   const int kMaxTryCount = INT_MAX; // if you want disable the threashhold, set it to be INT_MAX
+  static constexpr int64_t kSizeFoldThreshold = 32;
 
-  std::mutex gc_mutex_;
-  std::vector<Node*> gc_nodes_; 
+  // reclaim the unlinked nodes. mutable because contains() const needs a guard, and it could help to unlink by find()
+  mutable Reclaimer reclaimer_;
 };
 
 } // namespace sss
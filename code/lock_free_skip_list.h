@@ -0,0 +1,372 @@
+// lock-free skip list, i.e. the algorithm of the levels shared by LockFreeSkipSet and LockFreeSkipMap
+// read lock_free_skip_set.h first, add() and remove() in the comments here are the ones of the containers,
+// e.g. LockFreeSkipMap::put_if_absent() is its add()
+//
+// It owns the towers and the links, and it does
+// 1. find() from height_-1 down to level0, which unlinks the flagged nodes in the way
+// 2. link a new tower in level0 by the caller, then the other levels bottom up by link_other_levels()
+// 3. flag a tower top down by set_other_levels_flags() and try_flag_in_level0()
+// 4. retire a tower when both its adder and its remover have finished with it, check release_node()
+// Every failed CAS counts in stats_ and calls Backoff::fail(), check contention_manager.h and op_stats.h
+//
+// Node is the tower of the container, which needs
+// 1. key, height, unlink_refs and nexts[height] of FlagReference<Node>
+// 2. size_of(), construct() and destroy() for NodePool, check NodePool
+// The container derives from it privately, and adds its operations on the levels.
+
+#pragma once
+
+#include <iostream>
+#include <climits>
+#include <type_traits>
+#include <utility>
+#include <cassert>
+
+#include "atomic_flag_reference.h"
+#include "memory_order.h"
+#include "node_pool.h"
+#include "striped_counter.h"
+#include "contention_manager.h"
+#include "op_stats.h"
+
+namespace sss {
+
+template <class Node, class Reclaimer, class Backoff>
+class LockFreeSkipList {
+  static_assert(!Reclaimer::kNeedValidation, "LockFreeSkipList does not support reclaimer which needs validation");
+
+protected:
+  using Key = std::decay_t<decltype(std::declval<Node&>().key)>;
+
+  LockFreeSkipList() : height_(1), size_(kSizeFoldThreshold), pool_(kMaxHeight) {
+    head_ = pool_.acquire(kMaxHeight);
+    tail_ = pool_.acquire(kMaxHeight);
+
+    for (int level = 0; level < kMaxHeight; ++level) {
+      head_->nexts[level].set_ref(tail_);  // link head to tail in ctor()
+    }
+  }
+
+  // when dtor(), it needs the app to guarantee no thread is visiting the list.
+  // All nodes including head_ and tail_ are from pool_ which frees them,
+  // and reclaimer_ returns the unlinked nodes to pool_ before that
+  ~LockFreeSkipList() noexcept = default;
+
+  LockFreeSkipList(const LockFreeSkipList&) = delete;
+  LockFreeSkipList& operator=(const LockFreeSkipList&) = delete;
+
+  // From top, i.e. level = height_-1, to bottom, i.e., level = 0, travere each level in constant steps.
+  // NOTE: no node is higher than height_, check raise_height(), so levels above it are head_->tail_ and skipped.
+  // For each level, start from curr, which is in the next level of pred->nexts. 
+  // Traverse the whol level to get [pred, curr], where curr is the node which key is less than or equal to the key and pred->curr
+  // In the traverse path, if we meet any curr which is logically deleted, unlink it, i.e., physically deletion.
+  // 
+  // unlink using CAS could fail, if fail, restart again from the top level which is height_-1, 
+  // the reaseons for unlink failure are one of
+  // 1. The to-be-unlinked-curr has been unlinked by another concurrent thread. 
+  //    So restart will aovid that it happens again.
+  // 2. The pred has been deleted by other thread, either logically or physically. 
+  //    So restart will aovid the unlinked pred or unlink pred first.
+  // 3. pred not->curr, because new nodes could be added by other threads which make pred->new_added_node. 
+  //    So restart will avoid that pred->curr happens.
+  // 
+  // In theory, restart again will eventually success, but for debug reason, we set a failure count threshold
+  // 
+  // If success, save all preds and currs for each level to preds and succs as output 
+  // so it guarantees that 
+  // 1. each preds[i] is larger than the key
+  // 2. each succs[i] is less than or greater than the key
+  // 3. preds[i]->succs[i] at the time of visit them (but could be violated after that time)
+  // 
+  // preds[i], succs[i] could be logicall deleted or physically after exit or before exit of find()
+  // 
+  // return true if the key is found, false if the key is not found and gurarantee that 
+  // 1. The check node for the key is from level0. 
+  // 2. At least at one point of time in find(), the level0 node is not deleted, logically or physically
+  bool find(const Key& key, Node* preds[], Node* succs[]) {
+    int try_fail_cnt = 0;
+    Backoff backoff;
+
+    while (try_fail_cnt <= kMaxTryCount) {  // if kMaxTryCount == INT_MAX, it is while (true)
+      Node* pred = head_;   // restart point including first time
+      bool restart = false;
+
+      for (int level = height_.load(std::memory_order_acquire)-1; level >= 0; --level) {
+        Node* curr = pred->nexts[level].get_ref(kReadOrder);  // pred->curr in level
+        if (!traverse_with_unlink(level, key, pred, curr)) {
+          ++try_fail_cnt;
+          stats_.count(kRestart);
+          backoff.fail();
+          restart = true;
+          break;    // restart again
+        }
+        preds[level] = pred;
+        succs[level] = curr;
+      }
+
+      if (!restart)
+        return succs[0] != tail_ && succs[0]->key == key;
+    }
+
+    std::cerr << "too many failure when find(), fail times = " << try_fail_cnt << '\n';
+    exit(-1);
+  }
+
+  // Traverse in one level, starting from pred->curr which is guaranteed by caller find().
+  // 
+  // When success, return true. It means:
+  // Locate [pred, curr] where curr is bigger or equal to the key and pred->curr.
+  // It will guarantee that:
+  //    1. pred->curr
+  //       NOTE: other concurrent thread could change it after the exectuing thread 
+  //             which guarantee only at the executing time but the time does not mean the exit of the function 
+  //    2. pred < key 
+  //       NOTE: if pred is head_, it is less than anything
+  //    3. curr >= key
+  //       NOTE: if curr is tail_, it is bigger than anything
+  // 
+  // If CAS fails, return false
+  // 
+  // you can referecne lock_free_set_link_list.h for the similiar function
+  bool traverse_with_unlink(const int level, const Key& key, Node*& pred, Node*& curr) {
+    assert(pred == head_ || pred->key < key);
+    int64_t steps = 0;
+    stats_.count(kLevelTraversal);
+
+    while (curr != tail_) { 
+      // NOTE: tail_ can not be deleted and tail_ does not point to next object and tail_'s key is bigger than anyone
+      auto [succ, curr_logic_delete] = curr->nexts[level].get(kReadOrder);
+      ++steps;
+
+      if (curr_logic_delete) {
+        if (!try_unlink(level, pred, curr, succ)) { // try to unlink curr, if success, pred->succ in specific level 
+          stats_.count(kTraversalStep, steps);
+          return false;
+        }
+        if (!(curr->key == key))
+          stats_.count(kHelpingUnlink);
+
+        curr = succ;  // curr is unlinked, then set a new curr where pred->curr
+
+      } else {
+        if (curr == tail_ || curr->key >= key)
+          break;  // we found [pred, curr]
+        
+        pred = curr;
+        curr = succ;  // pred and curr both move where pred->curr
+      }
+    }
+
+    stats_.count(kTraversalStep, steps);
+    return true; 
+  }
+
+  // We just need to make the to_remove_node logically deleted,
+  // so it means the to_remove_node will be unlinked in futrue, eaving it for other threads using find().
+  // If to_remove_node is marked as deleted,
+  // The trick is that how to determine which thread set the flag because multi threads could call it concurrently.
+  // So we use CAS to judge which thread is the first one (and only one) for flipping the flag.
+  bool try_flag_in_level0(Node* const to_remove_node) const {
+    int try_fail_cnt = 0;
+    Backoff backoff;
+
+    while (try_fail_cnt <= kMaxTryCount) {
+      // NOTE: reload succ for each try, because another thread could link a new node after to_remove_node
+      auto [succ, already_deleted] = to_remove_node->nexts[0].get(kReadOrder);
+      if (already_deleted)
+        return false;   // to_remove_node has already been set logically deleted by other threads
+
+      const auto first_thread = to_remove_node->nexts[0].compare_and_set(succ, succ, false, true, kFlagOrder);
+      if (first_thread) {
+        return true;  // This thread is the first one to set logically deleted, i.e., flipping flag from false->true.
+      } else {
+        ++try_fail_cnt;
+        stats_.count(kFlagFail);
+        backoff.fail();
+        // else we will try again because compare_and_set() can not guarantee only one time of success 
+        // even the condition is true, i.e., right now, to_remove_node->succ and flag of to_remove_node is false.
+        // Check the documents of C++ atomic about compare_exchange_weak()
+      }
+    }
+
+    std::cerr << "too many failure when try_flag_logically_delete(), fail times = " << try_fail_cnt << '\n';
+    exit(-1);
+  }
+
+  void set_other_levels_flags(Node* const to_remove_node) const {
+    const auto height = to_remove_node->height;
+
+    for (int level = height-1; level > 0; --level) {
+      to_remove_node->nexts[level].set_flag(true, kFlagOrder);
+    }
+  }
+
+  // Link other levels for the new_node by caller add(). There are the following important guarantees
+  // 
+  // 1. The level0 has benn linked successfully by the current thread. check add().
+  // 
+  // 2. Linkage of levels of [1, top_height) is bottom-up 
+  //            and must be sucessful one level after another 
+  //            and only be executed by the current thread
+  //    because only one thread (that is me) can link successfully in level0 with the new_node
+  //            and go on for the linking job of other levels for the new_node.
+  //    NOTE: When the linkage finishs, some of the new_node->nexts[0~top_height) could be marked as deleted.
+  //          It means two nodes with the same key could exist in the same level other than level0.
+  //          e.g. in level1, node(5)->node(5).
+  //          But the previous one is absolutely marked as deleted so it does not violate the skip set property
+  //    
+  // I will give an example for the details of the garantee 2. 
+  // 
+  //     Thread0 tries to add node_0(5). Here 5 denotes that the key is 5 and 0 denotes that the thread is 0.
+  //     It succesfully links in level0. 
+  //     The guarantee is that only one node with value 5 in level0 exists, regardless of it is logically deleted or not.
+  //     Check add() and find() for the guarantee or read lock_free_set_link_list for more help.
+  // 
+  //     Then thread0 is trying to link in level1.
+  //     At the same time the node_0(5) is marked as deleted by thread1 in remove() 
+  //     and is unlinked by thread2 in find() in level0.
+  //     So thread3 can add the same key of 5 which is named as node_3(5). 
+  //     Thread3 links all level (e.g., level0 and level1) succesfully before thread0 finishs level1.
+  // 
+  //     Then thread0 comes to uses CAS to link in level1. 
+  //     Thread0 will fail for the first time because pred right now points to node_3(5) where it has no idea.
+  //     But after find() in thread0 for retry, the succ will be refreshed to be the node_3(5). 
+  //     NOTE: Even the retried find() in thread 0 return [preds, succs] which may have nothing about the node_0(5),  
+  //           but it does not matter.
+  // 
+  //     This time thread0 links successfully in level1 using CAS. 
+  //     And level1 has two same key nodes, node_0(5)->node_3(5).
+  //     But node_0(5) must be marked as deleted otherwise node_3(5) can not be linked in level0 and go on for level1.
+  //     It guarantees no violation for the following properties of skip set.
+  //        1. For level 0, each node is distinct.
+  //        2. For other levels, all nodes which are not marked as deleted are distinct. 
+  //           It could exist two nodes with the same key in the same level, but the previous node is marked as deleted.
+  //        Could more than two nodes with the same key exist in the heigher level? No!
+  //  
+  //     Let us see another scenario.
+  //       If thread0 linkage in level1 is successful before thread3 links node_3(5) in level1, what happens?
+  //       node_0(5) is marked as deleted and exist in level1. 
+  //       When thread3 tries to link node_3(5) and we assume that thread3 does not know the node_0(5) existence in level1, 
+  //       it will fail for the first time in link_other_levels(). 
+  //       Then it will retry with find(), which will unlink node_0(5) in level1. 
+  //       After the unlink, thread3 will link node_3(5) succesfully in level1. 
+  //       Now level1 only has one node for 5, i.e. node_3(5).
+  //
+  // The key points are described as the following:
+  //     1. In remove() the to-remove-node are marked as deleted (logically) from top to bottom. 
+  //     2. In level0 it guarantees distinction. One time, only one node of distinct key exists in level0.
+  void link_other_levels(Node* const new_node, const int top_height, Node* preds[], Node* succs[]) {
+    int try_fail_cnt = 0;
+    Backoff backoff;
+
+    for (int level = 1; level < top_height; ++level) {
+      if (new_node->nexts[0].get_flag(kReadOrder))
+        break;  // new_node has been removed by another thread, no need to link higher levels
+
+      while (try_fail_cnt <= kMaxTryCount) {
+        Node* pred = preds[level];  // restart point
+        Node* succ = succs[level];
+
+        if (try_link(level, new_node, pred, succ)) {
+          // the link must be visible before reading the level0 flag, 
+          // so either the remover's find() sees the level or we see the flag, pair with the one in remove()
+          store_load_fence();
+          break;  // for next level
+        } else {
+          ++try_fail_cnt;
+          stats_.count(kLinkUpperFail);
+          backoff.fail();
+          find(new_node->key, preds, succs);    // refresh preds and succs and restart
+        }
+      }
+    }
+
+    if (try_fail_cnt > kMaxTryCount) {
+      std::cerr << "too many failure when link_other_levels(), fail times = " << try_fail_cnt << '\n';
+      exit(-1);
+    }
+  }
+
+  // link new_node to [pred, curr] in the level
+  // NOTE1: new_node could be marked as delete in some levels and the key of new_node could be same as curr
+  // NOTE2: For other levels, try_link() can only be called by one thread for one new_node,
+  //        so it is thread-safe for new_node->nexts[level].set_ref(curr).
+  bool try_link(const int level, Node* const new_node, Node* const pred, Node* const curr) const {
+    new_node->nexts[level].set_ref(curr, kPrivateOrder); 
+
+    const bool success = pred->nexts[level].compare_and_set(curr, new_node, false, false, kLinkOrder);
+    return success;
+  }
+
+  // check lock_free_set_link_list.h for more info
+  // unlink curr when pred->curr and pred is not flagged as deleted, set pred->succ if successful
+  // NOTE: the node is not recycled here, because it could still be linked in other levels. Check release_node()
+  bool try_unlink(const int level, Node* const pred, Node* const curr, Node* const succ) noexcept {
+    // must be in logically delete. NOTE: all algorithm guarantee 0->1 for flag, no reverse
+    assert(curr != head_ && curr != tail_ && curr->nexts[level].get_flag(kReadOrder));  
+    
+    const bool unlink_success = pred->nexts[level].compare_and_set(curr, succ, false, false, kUnlinkOrder);
+
+    if (unlink_success && level == 0) {
+      size_.add(-1);
+    }
+    if (!unlink_success)
+      stats_.count(kUnlinkFail);
+
+    return unlink_success; 
+  }
+
+  // A node can only be retired when both add() and remove() have finished with it, i.e. unlink_refs drops to zero.
+  // 1. remove() calls find() after flipping the level0 flag, so all levels linked before that find() are unlinked.
+  // 2. add() checks the level0 flag after linking all levels, and calls find() if it is flagged,
+  //    so the levels linked after the remover's find() passed are unlinked too.
+  // Then no node or thread can get the node again, but a concurrent thread could still be visiting it,
+  // so we retire it to the reclaimer_ which frees it when all threads have left their guards.
+  // before_retire(node) is called by the last party before the node is retired,
+  // e.g. LockFreeSkipSet erases it from the hash index, so a thread which finds it in the index is protected by its guard
+  template <class BeforeRetire>
+  void release_node(Node* const node, BeforeRetire before_retire) {
+    if (node->unlink_refs.fetch_sub(1) == 1) {
+      before_retire(node);
+      reclaimer_.retire(node, recycle_node, &pool_);
+    }
+  }
+
+  void release_node(Node* const node) {
+    release_node(node, [](Node* const) {});
+  }
+
+  // return the node to the pool of the thread which frees it
+  static void recycle_node(void* const node, void* const pool) {
+    auto* const n = static_cast<Node*>(node);
+    static_cast<NodePool<Node>*>(pool)->release(n, n->height);
+  }
+
+  // height_ is the hint of the highest tower ever added, so traversals can skip the empty top levels.
+  // It is raised before the node is linked, so any thread which sees the node in a level sees the raised height_.
+  // NOTE: unlike SkipSet, it never decreases when the highest towers are removed, 
+  //       because a concurrent add() could be linking a tower of that height. 
+  //       It is a hint, the empty levels below it are correct but a little slower.
+  void raise_height(const int top_height) {
+    int height = height_.load(std::memory_order_relaxed);
+    while (height < top_height) {
+      if (height_.compare_exchange_weak(height, top_height, std::memory_order_release, std::memory_order_relaxed))
+        break;
+    }
+  }
+
+protected:
+  static constexpr int kMaxHeight = 32;
+  static constexpr int kMaxTryCount = INT_MAX;   // if you want to enable the threshold, set it less than INT_MAX
+  static constexpr int64_t kSizeFoldThreshold = 32;
+
+  Node* head_;
+  Node* tail_;
+  std::atomic<int> height_;   // the top level of all towers is height_-1, at least 1 for level0
+  StripedCounter size_;
+  NodePool<Node> pool_;          // NOTE: pool_ must be destroyed after reclaimer_ which returns nodes to it
+  mutable Reclaimer reclaimer_;  // mutable because the readers of the containers are const and need a guard
+  mutable OpStatsRecorder<kOpStats> stats_;   // empty if SSS_OP_STATS is not defined
+};
+
+} // namespace sss
@@ -0,0 +1,330 @@
+// lock free skip map, i.e. the map version of LockFreeSkipSet
+// read lock_free_skip_set.h first, the algorithm of the links is the same, i.e. LockFreeSkipList shared by both
+//
+// The value of a node is a pointer to an immutable value box, so the value can be updated in place
+// by CAS of the pointer, without removing and adding the node again.
+// The old box is retired to the reclaimer like an unlinked node, because a concurrent get() could be reading it.
+//
+// The value pointer is also the logical deletion of the map, like Java's ConcurrentSkipListMap,
+// i.e. remove() is the thread which CAS the value pointer from a box to nullptr.
+// After that, the remover (or any thread helping it) flags the node and unlinks it like LockFreeSkipSet.
+// So a node whose value is nullptr is treated as missing, even if its level0 flag has not been set yet.
+
+#pragma once
+
+#include <iostream>
+#include <optional>
+#include <climits>
+#include <new>
+
+#include "atomic_flag_reference.h"
+#include "memory_order.h"
+#include "epoch_reclaimer.h"
+#include "qsbr_reclaimer.h"
+#include "leak_reclaimer.h"
+#include "node_pool.h"
+#include "thread_random.h"
+#include "striped_counter.h"
+#include "contention_manager.h"
+#include "op_stats.h"
+#include "lock_free_skip_list.h"
+
+namespace sss {
+
+// the tower of LockFreeSkipMap, like LockFreeSkipSetNode with the value
+template <class K, class V>
+struct LockFreeSkipMapNode {
+  K key;
+  std::atomic<V*> value;   // nullptr means the key is removed, check remove()
+  const int height;
+  std::atomic<int> unlink_refs;   // check LockFreeSkipList::release_node()
+  sss::FlagReference<LockFreeSkipMapNode> nexts[1];   // NOTE: the real size is height
+
+  // for NodePool which constructs the towers in advance
+  static std::size_t size_of(const int height) {
+    return sizeof(LockFreeSkipMapNode) + (height-1)*sizeof(sss::FlagReference<LockFreeSkipMapNode>);
+  }
+
+  static LockFreeSkipMapNode* construct(void* const mem, const int height) {
+    assert(height > 0);
+    return new (mem) LockFreeSkipMapNode(height);
+  }
+
+  static void destroy(LockFreeSkipMapNode* const node) noexcept {
+    delete node->value.load(std::memory_order_relaxed);
+    node->~LockFreeSkipMapNode();
+  }
+
+  // a node from NodePool could be recycled, reset it to be a new one
+  void reset(const K& k, V* const v) {
+    key = k;
+    value.store(v, std::memory_order_relaxed);
+    for (int level = 0; level < height; ++level) {
+      nexts[level].set(nullptr, false, std::memory_order_relaxed);
+    }
+    unlink_refs.store(2, std::memory_order_relaxed);
+  }
+
+private:
+  explicit LockFreeSkipMapNode(const int h) : key(), value(nullptr), height(h), unlink_refs(2),
+                                              nexts{FlagReference<LockFreeSkipMapNode>(nullptr, false)} {
+    for (int level = 1; level < height; ++level) {
+      new (&nexts[level]) FlagReference<LockFreeSkipMapNode>(nullptr, false);
+    }
+  }
+
+  ~LockFreeSkipMapNode() noexcept = default;
+};
+
+// Reclaimer is the same as LockFreeSkipSet, it reclaims both the unlinked nodes and the replaced value boxes
+//
+// Backoff is the contention manager applied when a CAS fails, of the links or of the value, check contention_manager.h
+template <class K, class V, class Reclaimer = EpochReclaimer, class Backoff = NoBackoff>
+class LockFreeSkipMap : private LockFreeSkipList<LockFreeSkipMapNode<K, V>, Reclaimer, Backoff> {
+  static_assert(!Reclaimer::kNeedValidation, "LockFreeSkipMap does not support reclaimer which needs validation");
+
+private:
+  using Node = LockFreeSkipMapNode<K, V>;
+  using Base = LockFreeSkipList<Node, Reclaimer, Backoff>;
+  using Base::kMaxHeight;
+  using Base::kMaxTryCount;
+  using Base::head_;
+  using Base::tail_;
+  using Base::height_;
+  using Base::size_;
+  using Base::pool_;
+  using Base::reclaimer_;
+  using Base::stats_;
+  using Base::find;
+  using Base::try_flag_in_level0;
+  using Base::set_other_levels_flags;
+  using Base::link_other_levels;
+  using Base::try_link;
+  using Base::raise_height;
+
+public:
+  LockFreeSkipMap() = default;
+
+  // when dtor(), it needs the app to guarantee no thread is visiting the map, check ~LockFreeSkipList().
+  // The value boxes of the linked nodes are freed by Node::destroy() when pool_ is destroyed
+  ~LockFreeSkipMap() noexcept = default;
+
+  LockFreeSkipMap(const LockFreeSkipMap&) = delete;
+  LockFreeSkipMap& operator=(const LockFreeSkipMap&) = delete;
+
+  // the exact size aggregates the counter stripes of all threads, the approximate one is O(1). Check StripedCounter
+  int size(const SizeMode mode = SizeMode::kExact) const {
+    const auto size = mode == SizeMode::kExact ? size_.sum() : size_.approximate();
+    return static_cast<int>(std::max<int64_t>(size, 0));   // a concurrent unlink could be counted before its add()
+  }
+
+  bool empty() const {
+    return size() == 0;
+  }
+
+  // the concurrency statistics of all threads, all zero if SSS_OP_STATS is not defined, check op_stats.h
+  OpStats stats() const {
+    return stats_.collect();
+  }
+
+  // the calling thread holds no reference to any node. Check QsbrReclaimer
+  void quiescent() {
+    reclaimer_.quiescent();
+  }
+
+  // the calling thread will not visit the map for a long time. Check QsbrReclaimer
+  void offline() {
+    reclaimer_.offline();
+  }
+
+public:
+  // add the key with the value if the key does not exist, return false if it exists.
+  // Same as LockFreeSkipSet::add(), except that a found node which is being removed, i.e. its value is nullptr,
+  // is helped to finish the removal, then retry
+  bool put_if_absent(const K& key, const V& value) {
+    typename Reclaimer::Guard guard(reclaimer_);
+    int try_level_0_cnt = 0;
+    const int top_height = random_height();
+    Node* new_node = nullptr;
+    Backoff backoff;
+
+    raise_height(top_height);
+
+    while (try_level_0_cnt <= kMaxTryCount) {
+      Node* preds[kMaxHeight];
+      Node* succs[kMaxHeight];
+      const bool found = find(key, preds, succs);
+
+      if (found) {
+        if (succs[0]->value.load(std::memory_order_acquire) != nullptr) {
+          if (new_node != nullptr) {
+            delete new_node->value.exchange(nullptr, std::memory_order_relaxed);
+            pool_.release(new_node, top_height);
+          }
+          return false;
+        }
+
+        finish_remove(succs[0]);
+        ++try_level_0_cnt;
+        continue;
+      }
+
+      if (new_node == nullptr) {
+        new_node = pool_.acquire(top_height);
+        new_node->reset(key, new V(value));
+      }
+
+      if (!try_link(0, new_node, preds[0], succs[0])) {
+        ++try_level_0_cnt;
+        stats_.count(kLinkLevel0Fail);
+        backoff.fail();
+
+      } else {
+        link_other_levels(new_node, top_height, preds, succs);
+        size_.add(1);
+
+        // check LockFreeSkipSet::add()
+        if (new_node->nexts[0].get_flag(kReadOrder))
+          find(key, preds, succs);
+        release_node(new_node);
+        return true;
+      }
+    }
+
+    std::cerr << "too many failure when put_if_absent(), fail times = " << try_level_0_cnt << '\n';
+    exit(-1);
+  }
+
+  std::optional<V> get(const K& key) const {
+    typename Reclaimer::Guard guard(reclaimer_);
+    Node* const node = locate(key);
+    if (node == nullptr)
+      return std::nullopt;
+
+    const V* const box = node->value.load(std::memory_order_acquire);
+    if (box == nullptr)
+      return std::nullopt;    // removed
+
+    return *box;    // the box can not be freed until the guard is destroyed
+  }
+
+  bool contains(const K& key) const {
+    typename Reclaimer::Guard guard(reclaimer_);
+    Node* const node = locate(key);
+    return node != nullptr && node->value.load(std::memory_order_acquire) != nullptr;
+  }
+
+  // replace the value of an existing key in place, return false if the key does not exist
+  bool replace(const K& key, const V& value) {
+    return compute(key, [&value](const V&) { return value; });
+  }
+
+  // read-modify-write the value of an existing key in place, i.e. value = f(value),
+  // return false if the key does not exist.
+  // NOTE: f could be called more than once when other threads update the same key at the same time,
+  //       so f must have no side effect
+  template <class F>
+  bool compute(const K& key, F f) {
+    typename Reclaimer::Guard guard(reclaimer_);
+    Node* const node = locate(key);
+    if (node == nullptr)
+      return false;
+
+    Backoff backoff;
+    V* old_box = node->value.load(std::memory_order_acquire);
+    while (old_box != nullptr) {
+      V* const new_box = new V(f(static_cast<const V&>(*old_box)));
+      // if fail, old_box is refreshed
+      if (node->value.compare_exchange_weak(old_box, new_box, std::memory_order_acq_rel, std::memory_order_acquire)) {
+        reclaimer_.retire(old_box, delete_value);
+        return true;
+      }
+      delete new_box;
+      backoff.fail();
+    }
+
+    return false;   // removed by another thread
+  }
+
+  // the thread which CAS the value from a box to nullptr removes the key
+  bool remove(const K& key) {
+    typename Reclaimer::Guard guard(reclaimer_);
+    Node* preds[kMaxHeight];
+    Node* succs[kMaxHeight];
+    if (!find(key, preds, succs))
+      return false;
+
+    Node* const node = succs[0];
+    Backoff backoff;
+    V* box = node->value.load(std::memory_order_acquire);
+    while (box != nullptr) {
+      if (node->value.compare_exchange_weak(box, nullptr, std::memory_order_acq_rel, std::memory_order_acquire)) {
+        reclaimer_.retire(box, delete_value);
+        finish_remove(node);
+        return true;
+      }
+      stats_.count(kFlagFail);   // the value CAS is the logical deletion of the map, like the level0 flag of the set
+      backoff.fail();
+    }
+
+    return false;   // removed by another thread
+  }
+
+private:
+  // wait-free traversal like LockFreeSkipSet::contains(), return the node which is not flagged, or nullptr
+  // NOTE: the value of the node could be nullptr, i.e. the node is being removed
+  Node* locate(const K& key) const {
+    Node* pred = head_;
+
+    for (int level = height_.load(std::memory_order_acquire)-1; level >= 0; --level) {
+      Node* curr = pred->nexts[level].get_ref(kReadOrder);
+
+      while (true) {
+        if (curr->nexts[level].get_flag(kReadOrder)) {
+          curr = curr->nexts[level].get_ref(kReadOrder);
+        } else if (curr == tail_ || curr->key >= key) {
+          break;
+        } else {
+          pred = curr;
+          curr = pred->nexts[level].get_ref(kReadOrder);
+        }
+      }
+
+      if (curr != tail_ && curr->key == key)
+        return curr;
+    }
+
+    return nullptr;
+  }
+
+  // the value of node has been CAS to nullptr by remove(), flag the node and unlink it like LockFreeSkipSet::remove().
+  // Any thread can call it, but only the thread flipping the level0 flag unlinks it and releases it
+  void finish_remove(Node* const node) {
+    set_other_levels_flags(node);
+
+    if (try_flag_in_level0(node)) {
+      store_load_fence();   // check LockFreeSkipSet::remove()
+      Node* preds[kMaxHeight];
+      Node* succs[kMaxHeight];
+      find(node->key, preds, succs);  // unlink
+      release_node(node);
+    }
+  }
+
+  // NOTE: the value box has been retired by remove(), so the value of node is nullptr
+  void release_node(Node* const node) {
+    Base::release_node(node, [](Node* const n) {
+      assert(n->value.load(std::memory_order_relaxed) == nullptr);
+    });
+  }
+
+  static void delete_value(void* const box, void*) {
+    delete static_cast<V*>(box);
+  }
+
+  int random_height() const {
+    return ThreadRandom::geometric_height(kMaxHeight);
+  }
+};
+
+} // namespace sss
@@ -4,31 +4,142 @@
 #include <iostream>
 #include <iomanip>
 #include <algorithm>
+#include <string>
+#include <climits>
+#include <new>
+#include <optional>
 
 #include "atomic_flag_reference.h"
+#include "memory_order.h"
+#include "epoch_reclaimer.h"
+#include "qsbr_reclaimer.h"
+#include "leak_reclaimer.h"
+#include "node_pool.h"
+#include "thread_random.h"
+#include "striped_counter.h"
+#include "contention_manager.h"
+#include "op_stats.h"
+#include "hash_index.h"
+#include "lock_free_skip_list.h"
+#include "write_counter.h"
 
 namespace sss {
 
+// the consistency of LockFreeSkipSet::scan() and count_range() with concurrent add() and remove()
+// 1. kWeak, each key visited was in the set at some point during the scan, 
+//    but the keys as a whole could never be in the set at the same time, e.g. a key removed before another key added.
+//    It never blocks or retries.
+// 2. kPointInTime, the keys visited are exactly the keys in the range at one point of time during the scan.
+//    It validates that no add() or remove() changed the set during the scan, otherwise it scans again,
+//    so it could retry many times when writers are busy.
+//    NOTE: it needs the set with WriteCounter, check write_counter.h
+enum class ScanMode {
+  kWeak,
+  kPointInTime,
+};
+
+// the tunables of LockFreeSkipSet::spray_pop(), check SprayList by Dan Alistarh etc.
+// The spray starts at level log(p)+start_height and jumps forward a random number of nodes in [0, M*log(p)^3]
+// in each level, then descends descent levels, until level0. So it lands in about the first O(p*log(p)^3) nodes.
+// Bigger values spread the threads wider, i.e. less contention but the popped keys are farther from the minimum.
+struct SprayParams {
+  int threads = 1;          // p, the number of threads popping concurrently
+  int start_height = 1;     // K, the offset of the start level above log(p)
+  int jump_factor = 1;      // M, the scale of the max jump length
+  int descent = 1;          // D, the levels to descend after each jump
+};
+
+// Like SkipSet, the links of all levels are allocated in place after the node, i.e. one allocation for a tower,
+// so a level hop does not need to visit another heap block. Check NodePool for the memory layout.
+// NOTE: the tower of LockFreeSkipSet, it is out of the set because LockFreeSkipList is templated on it
 template <class T>
-class LockFreeSkipSet {
+struct LockFreeSkipSetNode {
+  T key;
+  const int height;
+  // two parties need to finish with the node before it can be retired, check LockFreeSkipList::release_node()
+  // 1. the thread of add() which links the node in all levels
+  // 2. the thread of remove() which flips the flag of level0 and unlinks the node in all levels
+  std::atomic<int> unlink_refs;
+  sss::FlagReference<LockFreeSkipSetNode> nexts[1];   // NOTE: the real size is height
+
+  // for NodePool which constructs the towers in advance
+  static std::size_t size_of(const int height) {
+    return sizeof(LockFreeSkipSetNode) + (height-1)*sizeof(sss::FlagReference<LockFreeSkipSetNode>);
+  }
+
+  static LockFreeSkipSetNode* construct(void* const mem, const int height) {
+    assert(height > 0);
+    return new (mem) LockFreeSkipSetNode(height);
+  }
+
+  static void destroy(LockFreeSkipSetNode* const node) noexcept {
+    node->~LockFreeSkipSetNode();
+  }
+
+  // a node from NodePool could be recycled, reset it to be a new one
+  void reset(const T& k) {
+    key = k;
+    for (int level = 0; level < height; ++level) {
+      nexts[level].set(nullptr, false, std::memory_order_relaxed);
+    }
+    unlink_refs.store(2, std::memory_order_relaxed);
+  }
 
 private:
-  // we could optimize struct Node.nexts with contigous memory right here, 
-  // we use std::vector for simplicity, and vector uses a pointer to contigous memory layout
-  struct Node {
-    T key;
-    std::vector<sss::FlagReference<Node>> nexts; 
-  
-    Node(const T& k, const int height) : key(k), 
-                                         nexts(height, FlagReference<Node>(nullptr, false)) {
-      assert(height > 0);
+  explicit LockFreeSkipSetNode(const int h) : key(), height(h), unlink_refs(2), nexts{FlagReference<LockFreeSkipSetNode>(nullptr, false)} {
+    for (int level = 1; level < height; ++level) {
+      new (&nexts[level]) FlagReference<LockFreeSkipSetNode>(nullptr, false);
     }
-  };
+  }
+
+  // NOTE: FlagReference is trivially destructible, only key needs to be destroyed
+  ~LockFreeSkipSetNode() noexcept = default;
+};
+
+// the algorithm of the levels is in LockFreeSkipList, which is shared with LockFreeSkipMap, check lock_free_skip_list.h
+//
+// Reclaimer is the policy of memory reclamation for the unlinked nodes, which could be
+// 1. EpochReclaimer (default), each operation enters an epoch guard
+// 2. QsbrReclaimer, zero overhead for operations, but each thread must call quiescent() regularly
+// 3. LeakReclaimer, keep all unlinked nodes until dtor()
+// NOTE: HazardPointerDomain is not supported, because traversal does not validate the nodes it visits
+// 
+// Backoff is the contention manager applied when a CAS fails, check contention_manager.h
+//
+// Index is the optional hash index for contains(), e.g. HashIndex<> which hashes T by std::hash<T>, check hash_index.h
+//
+// Writes is the optional write counters for ScanMode::kPointInTime, i.e. WriteCounter, check write_counter.h
+template <class T, class Reclaimer = EpochReclaimer, class Backoff = NoBackoff, class Index = NoHashIndex,
+          class Writes = NoWriteCounter>
+class LockFreeSkipSet : private LockFreeSkipList<LockFreeSkipSetNode<T>, Reclaimer, Backoff> {
+  static_assert(!Reclaimer::kNeedValidation, "LockFreeSkipSet does not support reclaimer which needs validation");
+
+private:
+  using Node = LockFreeSkipSetNode<T>;
+  using Base = LockFreeSkipList<Node, Reclaimer, Backoff>;
+  using Base::kMaxHeight;
+  using Base::kMaxTryCount;
+  using Base::head_;
+  using Base::tail_;
+  using Base::height_;
+  using Base::size_;
+  using Base::pool_;
+  using Base::reclaimer_;
+  using Base::stats_;
+  using Base::find;
+  using Base::traverse_with_unlink;
+  using Base::try_flag_in_level0;
+  using Base::set_other_levels_flags;
+  using Base::link_other_levels;
+  using Base::try_link;
+  using Base::raise_height;
 
 public:
+  // Iterator holds a guard of the reclaimer, so the nodes it visits can not be freed during its life.
+  // NOTE: a living Iterator blocks the reclamation of the whole set, and it must be used in the thread creating it
   class Iterator {
   public:
-    Iterator(Node* node) : curr_(node) {
+    Iterator(Node* node, Reclaimer& reclaimer) : curr_(node), guard_(reclaimer) {
       assert(node != nullptr);
     }
     ~Iterator() noexcept = default;
@@ -38,8 +149,8 @@ public:
     Iterator& operator++() {
       bool finish = false;
       while (!finish) {
-        curr_ = curr_->nexts[0].get_ref();
-        if (!curr_->nexts[0].get_flag())
+        curr_ = curr_->nexts[0].get_ref(kReadOrder);
+        if (!curr_->nexts[0].get_flag(kReadOrder))
           finish = true;
       }
       return *this;
@@ -59,93 +170,52 @@ public:
     
     private:
       Node* curr_;  
+      typename Reclaimer::Guard guard_;
     };
 
 public:
-  LockFreeSkipSet() : size_(0) {
-    head_ = new Node(T(), kMaxHeight);
-    tail_ = new Node(T(), kMaxHeight);
-
-    for (int level = 0; level < kMaxHeight; ++level) {
-      head_->nexts[level].set_ref(tail_);  // link head to tail in ctor()
-    }
+  LockFreeSkipSet() : LockFreeSkipSet(0) {}
 
-    std::srand(std::time(0));
-  }
+  // index_capacity is the number of slots of the hash index, 0 for the default of Index. Check hash_index.h
+  explicit LockFreeSkipSet(const std::size_t index_capacity) : index_(index_capacity) {}
 
-  ~LockFreeSkipSet() noexcept {
-    delete head_;
-    delete tail_;
-  }
+  // when dtor(), it needs the app to guarantee no thread is visiting the set, check ~LockFreeSkipList()
+  ~LockFreeSkipSet() noexcept = default;
 
   LockFreeSkipSet(const LockFreeSkipSet&) = delete;
   LockFreeSkipSet& operator=(const LockFreeSkipSet&) = delete;
 
-  int size() const {
-    assert(size_.load() >= 0);
-    return size_.load();
+  // the exact size aggregates the counter stripes of all threads, the approximate one is O(1). Check StripedCounter
+  int size(const SizeMode mode = SizeMode::kExact) const {
+    const auto size = mode == SizeMode::kExact ? size_.sum() : size_.approximate();
+    return static_cast<int>(std::max<int64_t>(size, 0));   // a concurrent unlink could be counted before its add()
   }
 
   bool empty() const {
     return size() == 0;
   }
 
-// read find() first even it is a private function
-private:    
-  // From top, i.e. level = KMaxLevl-1, to bottom, i.e., level = 0, travere each level in constant steps.
-  // For each level, start from curr, which is in the next level of pred->nexts. 
-  // Traverse the whol level to get [pred, curr], where curr is the node which key is less than or equal to the key and pred->curr
-  // In the traverse path, if we meet any curr which is logically deleted, unlink it, i.e., physically deletion.
-  // 
-  // unlink using CAS could fail, if fail, restart again from the top level which is kMaxHeight-1, 
-  // the reaseons for unlink failure are one of
-  // 1. The to-be-unlinked-curr has been unlinked by another concurrent thread. 
-  //    So restart will aovid that it happens again.
-  // 2. The pred has been deleted by other thread, either logically or physically. 
-  //    So restart will aovid the unlinked pred or unlink pred first.
-  // 3. pred not->curr, because new nodes could be added by other threads which make pred->new_added_node. 
-  //    So restart will avoid that pred->curr happens.
-  // 
-  // In theory, restart again will eventually success, but for debug reason, we set a failure count threshold
-  // 
-  // If success, save all preds and currs for each level to preds and succs as output 
-  // so it guarantees that 
-  // 1. each preds[i] is larger than the key
-  // 2. each succs[i] is less than or greater than the key
-  // 3. preds[i]->succs[i] at the time of visit them (but could be violated after that time)
-  // 
-  // preds[i], succs[i] could be logicall deleted or physically after exit or before exit of find()
-  // 
-  // return true if the key is found, false if the key is not found and gurarantee that 
-  // 1. The check node for the key is from level0. 
-  // 2. At least at one point of time in find(), the level0 node is not deleted, logically or physically
-  bool find(const T& key, Node* preds[], Node* succs[]) {
-    int try_fail_cnt = 0;
-
-    while (try_fail_cnt <= kMaxTryCount) {  // if kMaxTryCount == INT_MAX, it is while (true)
-      Node* pred = head_;   // restart point including first time
-      bool restart = false;
-
-      for (int level = kMaxHeight-1; level >= 0; --level) {
-        Node* curr = pred->nexts[level].get_ref();  // pred->curr in level
-        if (!traverse_with_unlink(level, key, pred, curr)) {
-          ++try_fail_cnt;
-          restart = true;
-          break;    // restart again
-        }
-        preds[level] = pred;
-        succs[level] = curr;
-      }
+  // the concurrency statistics of all threads, all zero if SSS_OP_STATS is not defined, check op_stats.h
+  OpStats stats() const {
+    return stats_.collect();
+  }
 
-      if (!restart)
-        return succs[0] != tail_ && succs[0]->key == key;
-    }
+  // the bytes of the hash index, 0 for NoHashIndex
+  std::size_t index_memory() const {
+    return index_.memory_bytes();
+  }
 
-    std::cerr << "too many failure when find(), fail times = " << try_fail_cnt << '\n';
-    exit(-1);
+  // the calling thread holds no reference to any node, i.e. no Iterator living. Check QsbrReclaimer
+  void quiescent() {
+    reclaimer_.quiescent();
   }
 
-// the public interfaces
+  // the calling thread will not visit the set for a long time. Check QsbrReclaimer
+  void offline() {
+    reclaimer_.offline();
+  }
+
+// the public interfaces, read LockFreeSkipList::find() first
 public:
   // For add() interface, 
   // first, call find() to get all preds and succs and check whether the key is already there.
@@ -161,20 +231,75 @@ public:
   //   2. pred in level 0 could be deleted, logically or physically, by another thread
   //   3. pred0->succ0 has been inserted other nodes by other threads, so pred0 not-> succ0
   // we do not know which one is the reason, so just repeat find() again to exclude reason 1
+  // 
+  // NOTE: new_node is from the per-thread pool_, and it is reused for the retries because no other thread can see it 
+  //       until it is linked in level0
   bool add(const T& key) {
+    typename Reclaimer::Guard guard(reclaimer_);
+    Node* preds[kMaxHeight];
+    Node* succs[kMaxHeight];
+    int finger_height = 0;    // no finger, so find() from head_
+    return add_with_finger(key, preds, succs, finger_height);
+  }
+
+  // add keys of [first, last) which are sorted in ascending order, e.g. ingesting a sorted batch.
+  // Return the number of keys added, i.e. the keys not existing before.
+  // 
+  // Each key starts the search from the preds and succs of the previous key, i.e. the finger, 
+  // and only re-searches the levels whose succ is not bigger than the key, check finger_find().
+  // For a dense sorted batch, most keys only need level0 and a few steps, 
+  // so the cost is near O(1) amortized instead of O(log n) for add().
+  // It falls back to find() from head_ when a CAS fails or the input is not sorted.
+  // 
+  // NOTE: the whole batch is in one guard, so the nodes of the finger can not be freed.
+  //       For EpochReclaimer, a huge batch delays the reclamation of all threads, so split it if needed.
+  template <class InputIt>
+  int add_batch(InputIt first, InputIt last) {
+    typename Reclaimer::Guard guard(reclaimer_);
+    Node* preds[kMaxHeight];
+    Node* succs[kMaxHeight];
+    int finger_height = 0;
+    int added = 0;
+
+    for (; first != last; ++first) {
+      if (add_with_finger(*first, preds, succs, finger_height))
+        ++added;
+    }
+    return added;
+  }
+
+private:
+  // preds and succs are the finger of a smaller key for levels of [0, finger_height), finger_height == 0 means no finger.
+  // When return, they are the finger of key, which could be used for the next bigger key.
+  bool add_with_finger(const T& key, Node* preds[], Node* succs[], int& finger_height) {
     int try_level_0_cnt = 0;
     int top_height = random_height();
+    Node* new_node = nullptr;
+    Backoff backoff;
+
+    // before find(), so find() returns preds and succs for all levels of new_node
+    raise_height(top_height);
+    bool use_finger = top_height <= finger_height;
 
     while (try_level_0_cnt <= kMaxTryCount) {
-      Node* preds[kMaxHeight];
-      Node* succs[kMaxHeight];
-      bool found = find(key, preds, succs);
+      bool found;
+      if (!use_finger || !finger_find(key, preds, succs, finger_height, found)) {
+        finger_height = height_.load(std::memory_order_acquire);  // find() fills at least these levels
+        found = find(key, preds, succs);
+      }
+      use_finger = false;   // if CAS fails, retry by find() from head_
 
-      if (found)
+      if (found) {
+        if (new_node != nullptr)
+          pool_.release(new_node, top_height);
         return false;
+      }
 
       // try to add new_node
-      Node* new_node = new Node(key, top_height);
+      if (new_node == nullptr) {
+        new_node = pool_.acquire(top_height);
+        new_node->reset(key);
+      }
 
       // NOTE: DON NOT DELETE THE FOLLOWING COMMENT !!!!!!!
       // first we prepare the links for new_node
@@ -188,17 +313,35 @@ public:
       */
 
       // link level 0 first
-      if (!try_link(0, new_node, preds[0], succs[0])) {
+      begin_write();
+      const bool linked = try_link(0, new_node, preds[0], succs[0]);
+      end_write();
+
+      if (!linked) {
         // link new_node to level 0 failed, we need to repeat find() all over
-        // including refresh preds & succs, for a brand nrew new_node and abandon current new_node
+        // including refresh preds & succs, and keep new_node for next try
         ++try_level_0_cnt;
-        delete new_node;
+        stats_.count(kLinkLevel0Fail);
+        backoff.fail();
 
       } else {
         // We have linked new_node to level 0 successfully.
         // It means the key is in the set. Now we will go on to link for other levels.
+        index_.insert(new_node);
         link_other_levels(new_node, top_height, preds, succs);
-        ++size_;
+        size_.add(1);
+
+        // new_node could be removed by another thread when we link other levels,
+        // and the remover's find() could miss the levels we link after it passes these levels.
+        // So we need to unlink them by ourselves before releasing new_node.
+        // NOTE: link_other_levels() calls store_load_fence() after each link, pair with the one in remove()
+        if (new_node->nexts[0].get_flag(kReadOrder)) {
+          find(key, preds, succs);
+        } else {
+          for (int level = 0; level < top_height; ++level)
+            preds[level] = new_node;    // the finger for the next bigger key
+        }
+        release_node(new_node);
         return true;
       }
     }
@@ -207,6 +350,39 @@ public:
     exit(-1);
   }
 
+  // like find() but start from the finger, i.e. preds and succs of a smaller key.
+  // The levels whose succ is bigger than the key still bracket the key, so keep them.
+  // The lowest levels whose succ is not bigger than the key are traversed again,
+  // starting from the pred of the finger in the highest one of them.
+  // 
+  // Return false if the finger can not be used, then the caller calls find() from head_
+  // 1. the key is not bigger than the finger, i.e. the input is not sorted
+  // 2. unlink fails, e.g. a pred of the finger has been removed
+  // NOTE: a pred of the finger could be removed when we use it, then the link CAS fails and add() retries by find()
+  bool finger_find(const T& key, Node* preds[], Node* succs[], const int finger_height, bool& found) {
+    if (preds[0] != head_ && !(preds[0]->key < key))
+      return false;   // all preds are less than the key if preds[0] is
+
+    int top = 0;
+    while (top < finger_height && succs[top] != tail_ && !(key < succs[top]->key))
+      ++top;
+
+    Node* pred = top > 0 ? preds[top-1] : nullptr;
+    for (int level = top-1; level >= 0; --level) {
+      Node* curr = pred->nexts[level].get_ref(kReadOrder);
+      if (!traverse_with_unlink(level, key, pred, curr)) {
+        stats_.count(kRestart);
+        return false;
+      }
+      preds[level] = pred;
+      succs[level] = curr;
+    }
+
+    found = succs[0] != tail_ && succs[0]->key == key;
+    return true;
+  }
+
+public:
   // remove() is set deleted flag, i.e. logically deleted, from top to bottom. 
   // 
   // NOTE the flipping operation may be run at the same time by another thread.
@@ -221,6 +397,7 @@ public:
   //
   // If the thread is the one who flip the level0 flag, it call find() again to unlink it.
   bool remove(const T& key) {
+    typename Reclaimer::Guard guard(reclaimer_);
     Node* preds[kMaxHeight];
     Node* succs[kMaxHeight];
     const bool found = find(key, preds, succs);
@@ -232,37 +409,72 @@ public:
 
     set_other_levels_flags(to_remove_node);
 
-    if (try_flag_in_level0(to_remove_node)) {
+    begin_write();
+    const bool flipped = try_flag_in_level0(to_remove_node);
+    end_write();
+
+    if (flipped) {
+      // the flag must be visible before find() reads the links, pair with the one in link_other_levels()
+      store_load_fence();
       find(key, preds, succs);  // unlink
+      release_node(to_remove_node);
       return true;
     } else {
       return false;
     }
   }
 
+  // with the hash index, a node found in the index which is not flagged is in level0, so the key is in the set.
+  // Otherwise the index could miss a node being added or not indexed, so search the skip set. Check hash_index.h
+  bool contains(const T& key) const {
+    typename Reclaimer::Guard guard(reclaimer_);
+    if constexpr (Index::kEnabled) {
+      Node* const node = index_.find(key);
+      if (node != nullptr && !node->nexts[0].get_flag(kReadOrder))
+        return true;
+    }
+    return contains_key(key);
+  }
+
+  // heterogeneous lookup if T has a probe_type, e.g. contains(std::string_view) for PrefixString,
+  // so the probe does not allocate a T. Check prefix_string.h
+  // NOTE: it always searches the skip set and skips the hash index, because Index hashes T, not the probe
+  //
+  // U = T makes the default of Probe dependent on the template parameters of contains(),
+  // so U::probe_type is only looked up when it is called, and a T without probe_type does not break the set
+  template <class K, class U = T, class Probe = typename U::probe_type>
+  bool contains(const K& key) const {
+    typename Reclaimer::Guard guard(reclaimer_);
+    return contains_key(Probe(key));
+  }
+
+private:
   // contains traverse like find() but do no unlink work
   // this way it guaratees wait-free buecause no CAS
   // NOTE: an optimization compared to the book. 
   // If we found a node's key equal to the key and is not marked as deleted, we found it
   // because the level0 node must not be marked as deleted. remove() guarantee this by mark from top to bottom.
-  bool contains(const T& key) const {
+  // NOTE: the caller holds the guard, so contains() enters it once for both the index and the search
+  template <class K>
+  bool contains_key(const K& key) const {
     Node* pred = head_;
 
-    for (int level = kMaxHeight-1; level >= 0; --level) {   
-      Node* curr = pred->nexts[level].get_ref();
+    for (int level = height_.load(std::memory_order_acquire)-1; level >= 0; --level) {   
+      Node* curr = pred->nexts[level].get_ref(kReadOrder);
 
       bool level_finish = false;
       while (!level_finish) {
-        bool curr_delete = curr->nexts[level].get_flag();
+        bool curr_delete = curr->nexts[level].get_flag(kReadOrder);
         if (curr_delete) {
-          curr = curr->nexts[level].get_ref();  // because tail_ is not mark as deleted, we can have an end
+          curr = curr->nexts[level].get_ref(kReadOrder);  // because tail_ is not mark as deleted, we can have an end
+          stats_.count(kMarkedSkip);
 
         } else {
           if (curr == tail_ || curr->key >= key) {
             level_finish = true;  // for next level
           } else {
             pred = curr;
-            curr = pred->nexts[level].get_ref();
+            curr = pred->nexts[level].get_ref(kReadOrder);
           }
         }
       }
@@ -274,23 +486,167 @@ public:
     return false;
   }
 
+public:
+  // priority queue mode, e.g. a timer scheduler which keeps popping the smallest deadline.
+  // Like Lotan and Shavit's priority queue, pop the first node in level0 which is not flagged
+  // by flipping its level0 flag like remove(), and then find() unlinks it.
+  // If another thread flips the flag first, try the next node.
+  // Return std::nullopt if the set is empty.
+  // NOTE: the popped key is the smallest at the time of the flag CAS among the keys not being popped,
+  //       but a smaller key added concurrently behind the visited nodes could be missed, 
+  //       i.e. it is quiescently consistent like Lotan and Shavit's without the timestamps.
+  std::optional<T> try_pop_min() {
+    typename Reclaimer::Guard guard(reclaimer_);
+    return pop_from(head_->nexts[0].get_ref(kReadOrder));
+  }
+
+  // relaxed pop for a work distribution queue which tolerates approximate ordering, check SprayParams.
+  // try_pop_min() makes all threads compete for the same first node,
+  // so the spray spreads the threads in the first nodes by a random walk from the upper levels.
+  // If the spray lands at the end, e.g. the set is small, it pops from the first node like try_pop_min().
+  // NOTE: with threads == 1, it is try_pop_min()
+  std::optional<T> spray_pop(const SprayParams& params = SprayParams()) {
+    typename Reclaimer::Guard guard(reclaimer_);
+    // the spray lands on the taller nodes more often, so the shorter ones are left behind near the head,
+    // a spray pops the first node in probability 1/p to clean them, like the cleaner of SprayList
+    if (params.threads <= 1 || ThreadRandom::next() % params.threads == 0)
+      return pop_from(head_->nexts[0].get_ref(kReadOrder));
+
+    int log_p = 0;
+    while ((2 << log_p) <= params.threads)
+      ++log_p;
+    const uint64_t max_jump = static_cast<uint64_t>(params.jump_factor) * log_p * log_p * log_p;
+    const int descent = std::max(1, params.descent);
+
+    Node* node = head_;
+    int level = std::min(log_p + params.start_height, height_.load(std::memory_order_acquire)-1);
+    while (true) {
+      for (auto jump = ThreadRandom::next() % (max_jump+1); jump > 0; --jump) {
+        Node* next = node->nexts[level].get_ref(kReadOrder);
+        while (next != tail_ && next->nexts[level].get_flag(kReadOrder))
+          next = next->nexts[level].get_ref(kReadOrder);
+        if (next == tail_)
+          break;
+        node = next;
+      }
+
+      if (level == 0)
+        break;
+      level = std::max(0, level-descent);
+    }
+
+    if (node == head_)
+      node = head_->nexts[0].get_ref(kReadOrder);
+    auto key = pop_from(node);
+    if (!key.has_value())
+      key = pop_from(head_->nexts[0].get_ref(kReadOrder));
+    return key;
+  }
+
+private:
+  // walk level0 from curr, and pop the first node which is not flagged
+  std::optional<T> pop_from(Node* curr) {
+    while (curr != tail_) {
+      auto [next, deleted] = curr->nexts[0].get(kReadOrder);
+      if (!deleted) {
+        set_other_levels_flags(curr);
+
+        begin_write();
+        const bool flipped = try_flag_in_level0(curr);
+        end_write();
+
+        if (flipped) {
+          store_load_fence();   // check remove()
+          T key = curr->key;
+          Node* preds[kMaxHeight];
+          Node* succs[kMaxHeight];
+          find(key, preds, succs);  // unlink
+          release_node(curr);
+          return key;
+        }
+      }
+      curr = next;
+    }
+
+    return std::nullopt;
+  }
+
+public:
+  // the smallest key, std::nullopt if the set is empty
+  std::optional<T> peek_min() const {
+    typename Reclaimer::Guard guard(reclaimer_);
+    Node* curr = head_->nexts[0].get_ref(kReadOrder);
+
+    while (curr != tail_) {
+      auto [next, deleted] = curr->nexts[0].get(kReadOrder);
+      if (!deleted)
+        return curr->key;
+      curr = next;
+    }
+
+    return std::nullopt;
+  }
+
+  // visit keys in [lo, hi] in ascending order by visitor(const T& key), return the number of keys visited.
+  // It seeks the first key >= lo through the upper levels, then streams level0 with acquire loads.
+  // NOTE: for ScanMode::kPointInTime, the keys are buffered until the scan is validated, then visited
+  template <class Visitor>
+  int scan(const T& lo, const T& hi, Visitor visitor, const ScanMode mode = ScanMode::kWeak) const {
+    typename Reclaimer::Guard guard(reclaimer_);
+
+    if (mode == ScanMode::kWeak) {
+      int cnt = 0;
+      stream(lower_bound(lo), hi, [&](const T& key) { visitor(key); ++cnt; });
+      return cnt;
+    }
+
+    std::vector<T> keys;
+    while (true) {
+      keys.clear();
+      if (snapshot(lo, hi, [&keys](const T& key) { keys.push_back(key); }))
+        break;
+    }
+    for (const auto& key : keys) 
+      visitor(key);
+    return static_cast<int>(keys.size());
+  }
+
+  // the number of keys in [lo, hi], check scan() for mode
+  int count_range(const T& lo, const T& hi, const ScanMode mode = ScanMode::kWeak) const {
+    typename Reclaimer::Guard guard(reclaimer_);
+    int cnt = 0;
+
+    if (mode == ScanMode::kWeak) {
+      stream(lower_bound(lo), hi, [&cnt](const T&) { ++cnt; });
+      return cnt;
+    }
+
+    while (true) {
+      cnt = 0;
+      if (snapshot(lo, hi, [&cnt](const T&) { ++cnt; }))
+        return cnt;
+    }
+  }
+
   Iterator locate(const T& key) {
+    typename Reclaimer::Guard guard(reclaimer_);
     Node* preds[kMaxHeight];
     Node* succs[kMaxHeight];
 
     if (!find(key, preds, succs)) {
-      return Iterator(tail_);
+      return Iterator(tail_, reclaimer_);
     } else {
-      return Iterator(succs[0]);
+      return Iterator(succs[0], reclaimer_);
     }
   }
 
   Iterator begin() {
-    return Iterator(head_[0]->nexts[0].get_ref());
+    typename Reclaimer::Guard guard(reclaimer_);
+    return Iterator(head_->nexts[0].get_ref(kReadOrder), reclaimer_);
   }
 
   Iterator end() {
-    return Iterator(tail_);
+    return Iterator(tail_, reclaimer_);
   }
 
   void debug_print() const {
@@ -316,7 +672,7 @@ private:
       res += ", ";
       res +=  (node->nexts[level].get_flag() ? "-" : "+");
       res += ", height = ";
-      res += std::to_string(node->nexts.size());
+      res += std::to_string(node->height);
       return res;
     }
   }
@@ -361,7 +717,7 @@ private:
         for (int r = 0; r < row_cnt; ++r) 
           grid[r][col_cnt-1] = tail_;
       } else {
-        for (int r = 0, ht = curr->nexts.size(); r < ht; ++r) 
+        for (int r = 0, ht = curr->height; r < ht; ++r) 
           grid[row_cnt-r-1][c] = curr;        
       }
 
@@ -375,220 +731,108 @@ private:
     int max_height = 0;
     Node* n = head_->nexts[0].get_ref();
     while (n != tail_) {
-      max_height = std::max(max_height, static_cast<int>(n->nexts.size()));
+      max_height = std::max(max_height, n->height);
       n = n->nexts[0].get_ref();
     }
     return max_height;
   }
 
 private:
-  // Traverse in one level, starting from pred->curr which is guaranteed by caller find().
-  // 
-  // When success, return true. It means:
-  // Locate [pred, curr] where curr is bigger or equal to the key and pred->curr.
-  // It will guarantee that:
-  //    1. pred->curr
-  //       NOTE: other concurrent thread could change it after the exectuing thread 
-  //             which guarantee only at the executing time but the time does not mean the exit of the function 
-  //    2. pred < key 
-  //       NOTE: if pred is head_, it is less than anything
-  //    3. curr >= key
-  //       NOTE: if curr is tail_, it is bigger than anything
-  // 
-  // If CAS fails, return false
-  // 
-  // you can referecne lock_free_set_link_list.h for the similiar function
-  bool traverse_with_unlink(const int level, const T& key, Node*& pred, Node*& curr) {
-    assert(pred == head_ || pred->key < key);
-
-    while (curr != tail_) { 
-      // NOTE: tail_ can not be deleted and tail_ does not point to next object and tail_'s key is bigger than anyone
-      auto [succ, curr_logic_delete] = curr->nexts[level].get();
-
-      if (curr_logic_delete) {
-        if (!try_unlink(level, pred, curr, succ)) // try to unlink curr, if success, pred->succ in specific level 
-          return false;
-
-        curr = succ;  // curr is unlinked, then set a new curr where pred->curr
+  // NOTE: erase it from index_ before retire, so a thread which finds it in index_ is protected by its guard.
+  //       Check LockFreeSkipList::release_node()
+  void release_node(Node* const node) {
+    Base::release_node(node, [this](Node* const n) { index_.erase(n); });
+  }
 
-      } else {
-        if (curr == tail_ || curr->key >= key)
-          break;  // we found [pred, curr]
-        
-        pred = curr;
-        curr = succ;  // pred and curr both move where pred->curr
+  // the first node in level0 which is not flagged and its key >= lo, or tail_.
+  // Traverse like contains(), so it is wait-free
+  Node* lower_bound(const T& lo) const {
+    Node* pred = head_;
+    Node* curr = nullptr;
+
+    for (int level = height_.load(std::memory_order_acquire)-1; level >= 0; --level) {
+      curr = pred->nexts[level].get_ref(kReadOrder);
+      while (true) {
+        if (curr->nexts[level].get_flag(kReadOrder)) {
+          curr = curr->nexts[level].get_ref(kReadOrder);
+          stats_.count(kMarkedSkip);
+        } else if (curr == tail_ || !(curr->key < lo)) {
+          break;
+        } else {
+          pred = curr;
+          curr = pred->nexts[level].get_ref(kReadOrder);
+        }
       }
     }
-
-    return true; 
+    return curr;
   }
 
-  // We just need to make the to_remove_node logically deleted,
-  // so it means the to_remove_node will be unlinked in futrue, eaving it for other threads using find().
-  // If to_remove_node is marked as deleted,
-  // The trick is that how to determine which thread set the flag because multi threads could call it concurrently.
-  // So we use CAS to judge which thread is the first one (and only one) for flipping the flag.
-  bool try_flag_in_level0(Node* const to_remove_node) const {
-    int try_fail_cnt = 0;
-    Node* const succ = to_remove_node[0].nexts[0].get_ref();  
-
-    while (try_fail_cnt <= kMaxTryCount) {
-      const auto first_thread = to_remove_node->nexts[0].compare_and_set(succ, succ, false, true);
-      if (first_thread) {
-        return true;  // This thread is the first one to set logically deleted, i.e., flipping flag from false->true.
-      } else {
-        ++try_fail_cnt;
-        // maybe to_remove_node has already been set logically deleted by other threads, we need test it
-        const auto already_deleted = to_remove_node->nexts[0].get_flag();
-        if (already_deleted)
-          return false;   
-        // else we will try again because compare_and_set() can not guarantee only one time of success 
-        // even the condition is true, i.e., right now, to_remove_node->succ and flag of to_remove_node is false.
-        // Check the documents of C++ atomic about compare_exchange_weak()
-      }
+  // visit the keys in level0 from node until the key is bigger than hi, skip the flagged nodes.
+  // NOTE: acquire is enough for the weak consistency, it pairs with the release (or seq_cst) CAS of links
+  template <class F>
+  void stream(Node* node, const T& hi, F f) const {
+    while (node != tail_ && !(hi < node->key)) {
+      auto [next, deleted] = node->nexts[0].get(std::memory_order_acquire);
+      if (!deleted)
+        f(node->key);
+      node = next;
     }
-
-    std::cerr << "too many failure when try_flag_logically_delete(), fail times = " << try_fail_cnt << '\n';
-    exit(-1);
   }
 
-  void set_other_levels_flags(Node* const to_remove_node) const {
-    const auto height = to_remove_node->nexts.size();
-
-    for (int level = height-1; level > 0; --level) {
-      to_remove_node->nexts[level].set_flag(true);
+  // one try of the point-in-time scan, like a seqlock for the readers.
+  // Every add() which links level0 and every remove() which flags level0, i.e. the linearization points,
+  // are between begin_write() and end_write().
+  // If no writer is in progress at the start and no writer begins until the end, 
+  // the set does not change during the scan, so the keys are the keys at any point of the scan.
+  // Return false if it is not valid and the caller must discard the keys and retry
+  template <class F>
+  bool snapshot(const T& lo, const T& hi, F f) const {
+    if constexpr (!Writes::kEnabled) {
+      std::cerr << "ScanMode::kPointInTime needs LockFreeSkipSet with WriteCounter, check write_counter.h\n";
+      exit(-1);
     }
-  }
 
-  // Link other levels for the new_node by caller add(). There are the following important guarantees
-  // 
-  // 1. The level0 has benn linked successfully by the current thread. check add().
-  // 
-  // 2. Linkage of levels of [1, top_height) is bottom-up 
-  //            and must be sucessful one level after another 
-  //            and only be executed by the current thread
-  //    because only one thread (that is me) can link successfully in level0 with the new_node
-  //            and go on for the linking job of other levels for the new_node.
-  //    NOTE: When the linkage finishs, some of the new_node->nexts[0~top_height) could be marked as deleted.
-  //          It means two nodes with the same key could exist in the same level other than level0.
-  //          e.g. in level1, node(5)->node(5).
-  //          But the previous one is absolutely marked as deleted so it does not violate the skip set property
-  //    
-  // I will give an example for the details of the garantee 2. 
-  // 
-  //     Thread0 tries to add node_0(5). Here 5 denotes that the key is 5 and 0 denotes that the thread is 0.
-  //     It succesfully links in level0. 
-  //     The guarantee is that only one node with value 5 in level0 exists, regardless of it is logically deleted or not.
-  //     Check add() and find() for the guarantee or read lock_free_set_link_list for more help.
-  // 
-  //     Then thread0 is trying to link in level1.
-  //     At the same time the node_0(5) is marked as deleted by thread1 in remove() 
-  //     and is unlinked by thread2 in find() in level0.
-  //     So thread3 can add the same key of 5 which is named as node_3(5). 
-  //     Thread3 links all level (e.g., level0 and level1) succesfully before thread0 finishs level1.
-  // 
-  //     Then thread0 comes to uses CAS to link in level1. 
-  //     Thread0 will fail for the first time because pred right now points to node_3(5) where it has no idea.
-  //     But after find() in thread0 for retry, the succ will be refreshed to be the node_3(5). 
-  //     NOTE: Even the retried find() in thread 0 return [preds, succs] which may have nothing about the node_0(5),  
-  //           but it does not matter.
-  // 
-  //     This time thread0 links successfully in level1 using CAS. 
-  //     And level1 has two same key nodes, node_0(5)->node_3(5).
-  //     But node_0(5) must be marked as deleted otherwise node_3(5) can not be linked in level0 and go on for level1.
-  //     It guarantees no violation for the following properties of skip set.
-  //        1. For level 0, each node is distinct.
-  //        2. For other levels, all nodes which are not marked as deleted are distinct. 
-  //           It could exist two nodes with the same key in the same level, but the previous node is marked as deleted.
-  //        Could more than two nodes with the same key exist in the heigher level? No!
-  //  
-  //     Let us see another scenario.
-  //       If thread0 linkage in level1 is successful before thread3 links node_3(5) in level1, what happens?
-  //       node_0(5) is marked as deleted and exist in level1. 
-  //       When thread3 tries to link node_3(5) and we assume that thread3 does not know the node_0(5) existence in level1, 
-  //       it will fail for the first time in link_other_levels(). 
-  //       Then it will retry with find(), which will unlink node_0(5) in level1. 
-  //       After the unlink, thread3 will link node_3(5) succesfully in level1. 
-  //       Now level1 only has one node for 5, i.e. node_3(5).
-  //
-  // The key points are described as the following:
-  //     1. In remove() the to-remove-node are marked as deleted (logically) from top to bottom. 
-  //     2. In level0 it guarantees distinction. One time, only one node of distinct key exists in level0.
-  void link_other_levels(Node* const new_node, const int top_height, Node* preds[], Node* succs[]) {
-    int try_fail_cnt = 0;
-
-    for (int level = 1; level < top_height; ++level) {
-      while (try_fail_cnt <= kMaxTryCount) {
-        Node* pred = preds[level];  // restart point
-        Node* succ = succs[level];
+    // NOTE: the counters are striped, but each stripe only increases, so equal sums mean no stripe changes
+    const auto started = writes_.started();
+    if (writes_.finished() != started)
+      return false;   // some writer in progress
 
-        if (try_link(level, new_node, pred, succ)) {
-          break;  // for next level
-        } else {
-          ++try_fail_cnt;
-          find(new_node->key, preds, succs);    // refresh preds and succs and restart
-        }
-      }
-    }
+    stream(lower_bound(lo), hi, f);
 
-    if (try_fail_cnt > kMaxTryCount) {
-      std::cerr << "too many failure when link_other_levels(), fail times = " << try_fail_cnt << '\n';
-      exit(-1);
-    }
+    // the acquire loads of the links can not be reordered after it, 
+    // and if we saw the CAS of a writer, we see its begin_write() too
+    return writes_.started() == started;
   }
 
-  // link new_node to [pred, curr] in the level
-  // NOTE1: new_node could be marked as delete in some levels and the key of new_node could be same as curr
-  // NOTE2: For other levels, try_link() can only be called by one thread for one new_node,
-  //        so it is thread-safe for new_node->nexts[level].set_ref(curr).
-  bool try_link(const int level, Node* const new_node, Node* const pred, Node* const curr) const {
-    new_node->nexts[level].set_ref(curr); 
+  // no-op with NoWriteCounter, so the writers pay nothing if no point-in-time scan is needed
+  void begin_write() noexcept {
+    writes_.begin();
+  }
 
-    const bool success = pred->nexts[level].compare_and_set(curr, new_node, false, false);
-    return success;
+  void end_write() noexcept {
+    writes_.end();
   }
 
-  // check lock_free_set_link_list.h for more info
-  // unlink curr when pred->curr and pred is not flagged as deleted, set pred->succ if successful
-  // when level == 0, recycle the node
-  bool try_unlink(const int level, Node* const pred, Node* const curr, Node* const succ) noexcept {
-    // must be in logically delete. NOTE: all algorithm guarantee 0->1 for flag, no reverse
-    assert(curr != head_ && curr != tail_ && curr->nexts[level].get_flag());  
-    
-    const bool unlink_success = pred->nexts[level].compare_and_set(curr, succ, false, false);
 
-    if (unlink_success && level == 0) {
-      // TODO: gc
-      assert(size_.load() > 0);
-      --size_;  
-    }
-
-    return unlink_success; 
-  }
 
   // return rand height in [1, kMaxHeight], i.e. for level, it is [0, kMaxHeight)
+  // NOTE: it uses the generator of the calling thread, call ThreadRandom::seed() for reproducible heights
   int random_height() const {
+    if (kProbability == 0.5)
+      return ThreadRandom::geometric_height(kMaxHeight);
+
     int lvl = 1;
-    if (kProbability == 0.5) {
-      while (rand() % 2 == 0 && lvl < kMaxHeight) {
-        ++lvl;
-      }
-    } else {
-      while ((static_cast<float>(rand()) / RAND_MAX) < kProbability && lvl < kMaxHeight) {
-        ++lvl;
-      }
+    while (ThreadRandom::uniform() < kProbability && lvl < kMaxHeight) {
+      ++lvl;
     }
     return lvl;
   }
 
 private:
-  Node* head_;
-  Node* tail_;
-  std::atomic<int> size_;
+  Writes writes_;   // counters of add() and remove() which change the set, for ScanMode::kPointInTime
+  typename Index::template Table<Node> index_;
 
-  const int kMaxHeight = 32;
   const float kProbability = 0.5;
-  const int kMaxTryCount = INT_MAX;
 
 };
 
@@ -0,0 +1,55 @@
+// memory orders of the lock-free containers
+//
+// By default, all atomic operations of the links are seq_cst,
+// the same as Java's AtomicMarkableReference which the algorithms of the book are based on.
+// It costs a full fence for every store and CAS on x86, and for every load on ARM.
+//
+// Define SSS_TUNED_MEMORY_ORDER (e.g. -DSSS_TUNED_MEMORY_ORDER) to use the audited weaker orders:
+// 1. kReadOrder, acquire, for reading a link in traversals.
+//    The node it points to, i.e. its key and links, is published by the release CAS of kLinkOrder.
+// 2. kLinkOrder, release, for the CAS which links a new node in a level.
+// 3. kUnlinkOrder, release, for the CAS which unlinks a deleted node, i.e. pred->curr to pred->succ.
+//    The unlinking thread acquired succ, so a reader of the new link acquires succ transitively.
+// 4. kFlagOrder, relaxed, for flagging a node as deleted. The flag publishes no data,
+//    and the read-modify-write keeps the release sequence of the link, so a reader still acquires the ref.
+// 5. kPrivateOrder, relaxed, for the links of a new node which no other thread can see until kLinkOrder.
+//
+// Weaker orders do not give the store-load ordering of seq_cst, which two places need (Dekker's pattern):
+// 1. In LockFreeSkipSet, the adder links a level then reads the level0 flag,
+//    and the remover flags level0 then traverses the levels to unlink. One of them must see the other.
+// 2. In reclaimers, publishing a hazard pointer or an epoch then reading the links,
+//    and unlinking then scanning the hazard pointers or reading the epoch.
+// So they call store_load_fence() which is a seq_cst fence, and is nothing by default because all operations are seq_cst.
+
+#pragma once
+
+#include <atomic>
+
+namespace sss {
+
+#ifdef SSS_TUNED_MEMORY_ORDER
+
+constexpr bool kTunedMemoryOrder = true;
+constexpr std::memory_order kReadOrder = std::memory_order_acquire;
+constexpr std::memory_order kLinkOrder = std::memory_order_release;
+constexpr std::memory_order kUnlinkOrder = std::memory_order_release;
+constexpr std::memory_order kFlagOrder = std::memory_order_relaxed;
+constexpr std::memory_order kPrivateOrder = std::memory_order_relaxed;
+
+#else
+
+constexpr bool kTunedMemoryOrder = false;
+constexpr std::memory_order kReadOrder = std::memory_order_seq_cst;
+constexpr std::memory_order kLinkOrder = std::memory_order_seq_cst;
+constexpr std::memory_order kUnlinkOrder = std::memory_order_seq_cst;
+constexpr std::memory_order kFlagOrder = std::memory_order_seq_cst;
+constexpr std::memory_order kPrivateOrder = std::memory_order_seq_cst;
+
+#endif
+
+inline void store_load_fence() noexcept {
+  if constexpr (kTunedMemoryOrder)
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+} // namespace sss
@@ -0,0 +1,155 @@
+// per-thread node pool for the lock-free skip set
+//
+// Each thread has its own free lists, one list for each height of tower,
+// so acquire() and release() touch no shared data in the common case.
+// When a free list is empty, it is refilled in bulk from the shared depot or from a new chunk of nodes.
+// When a free list is too long, e.g. the thread removes much more than it adds,
+// a batch of nodes is moved to the shared depot for other threads.
+//
+// Nodes are constructed once in a chunk and never destroyed until the pool is destroyed,
+// so a node from acquire() is a ready-made tower, the caller only needs to reset its key and links.
+//
+// A node is a tower of variable size, i.e. its links are allocated in place after the node, 
+// so Node must have the following static member functions
+// 1. std::size_t size_of(const int height), the bytes of the node with the tower
+// 2. Node* construct(void* mem, const int height)
+// 3. void destroy(Node* node) noexcept
+//
+// The block of a node is aligned to the smallest power of two which is not less than its size, up to a cache line,
+// so a small node never straddles two cache lines and a big node starts from a cache line.
+
+#pragma once
+
+#include <vector>
+#include <mutex>
+#include <new>
+#include <algorithm>
+#include <cstddef>
+#include <cassert>
+
+#include "thread_slot.h"
+
+namespace sss {
+
+template <class Node>
+class NodePool {
+public:
+  explicit NodePool(const int max_height) : max_height_(max_height), depot_(max_height+1) {}
+
+  // when dtor(), no thread can use the pool
+  ~NodePool() noexcept {
+    for (const auto& chunk : chunks_) {
+      for (int i = 0; i < chunk.count; ++i) {
+        Node::destroy(reinterpret_cast<Node*>(chunk.mem + i*chunk.block_size));
+      }
+      ::operator delete(static_cast<void*>(chunk.mem), std::align_val_t(kCacheLineSize));
+    }
+  }
+
+  NodePool(const NodePool&) = delete;
+  NodePool& operator=(const NodePool&) = delete;
+
+  Node* acquire(const int height) {
+    assert(height > 0 && height <= max_height_);
+    auto& list = local_list(height);
+
+    if (list.empty())
+      refill(list, height);
+
+    Node* const node = list.back();
+    list.pop_back();
+    return node;
+  }
+
+  // node must be acquired from the pool with the same height
+  void release(Node* const node, const int height) {
+    assert(height > 0 && height <= max_height_);
+    auto& list = local_list(height);
+    list.push_back(node);
+
+    if (static_cast<int>(list.size()) > kMaxLocal)
+      flush(list, height);
+  }
+
+private:
+  struct Chunk {
+    char* mem;
+    std::size_t block_size;
+    int count;
+  };
+
+  // padding to cache line to avoid false sharing between threads
+  struct alignas(64) Cache {
+    std::vector<std::vector<Node*>> lists;   // lists[height], only visited by the thread of the slot
+  };
+
+  std::vector<Node*>& local_list(const int height) {
+    auto& cache = caches_[ThreadSlot::id()];
+    if (cache.lists.empty())
+      cache.lists.resize(max_height_+1);
+    return cache.lists[height];
+  }
+
+  // higher towers are rarer, so refill less of them, i.e., kRefillBatch for height 1, half for height 2, ...
+  int refill_batch(const int height) const {
+    return std::max(1, kRefillBatch >> (height-1));
+  }
+
+  static std::size_t block_size(const int height) {
+    const std::size_t size = Node::size_of(height);
+    if (size >= kCacheLineSize)
+      return (size + kCacheLineSize-1) / kCacheLineSize * kCacheLineSize;
+
+    std::size_t block = 1;
+    while (block < size) 
+      block <<= 1;
+    return block;
+  }
+
+  void refill(std::vector<Node*>& list, const int height) {
+    const int batch = refill_batch(height);
+
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      auto& shared = depot_[height];
+      const int n = std::min(batch, static_cast<int>(shared.size()));
+      list.insert(list.end(), shared.end()-n, shared.end());
+      shared.resize(shared.size()-n);
+    }
+    if (!list.empty())
+      return;
+
+    // one allocation for the whole batch
+    const auto size = block_size(height);
+    char* const mem = static_cast<char*>(::operator new(size * batch, std::align_val_t(kCacheLineSize)));
+    for (int i = 0; i < batch; ++i) {
+      list.push_back(Node::construct(mem + i*size, height));
+    }
+
+    std::lock_guard<std::mutex> guard(mutex_);
+    chunks_.push_back({mem, size, batch});
+  }
+
+  void flush(std::vector<Node*>& list, const int height) {
+    const int n = static_cast<int>(list.size()) - kMaxLocal/2;
+
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto& shared = depot_[height];
+    shared.insert(shared.end(), list.end()-n, list.end());
+    list.resize(list.size()-n);
+  }
+
+private:
+  static constexpr std::size_t kCacheLineSize = 64;
+  static constexpr int kRefillBatch = 64;
+  static constexpr int kMaxLocal = 256;
+
+  const int max_height_;
+  Cache caches_[ThreadSlot::kMaxThreads];
+
+  std::mutex mutex_;   // guard depot_ and chunks_, only locked for a batch of nodes
+  std::vector<std::vector<Node*>> depot_;
+  std::vector<Chunk> chunks_;
+};
+
+} // namespace sss
@@ -0,0 +1,110 @@
+// per-operation concurrency statistics of the lock-free containers
+//
+// Define SSS_OP_STATS (e.g. -DSSS_OP_STATS) to record them, then call stats() of the container,
+// e.g. LockFreeSkipSet::stats(), to see why it slows down under load.
+// By default, OpStatsRecorder<false> is an empty class and all its functions are empty inline ones,
+// so the disabled build has no code and no data for the statistics.
+//
+// Each thread counts in its own slot indexed by ThreadSlot::id(), which is padded to cache lines,
+// and only the owner thread writes it, so a count is a relaxed load and store, no read-modify-write.
+// collect() aggregates all slots on demand, so it is slow and not a snapshot of one point of time.
+// NOTE: when a thread exits, its slot id could be reused by a new thread, which goes on with the old counts.
+//       It is fine because collect() only cares the sum of all threads.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <algorithm>
+
+#include "thread_slot.h"
+
+namespace sss {
+
+#ifdef SSS_OP_STATS
+constexpr bool kOpStats = true;
+#else
+constexpr bool kOpStats = false;
+#endif
+
+enum OpCounter {
+  kLinkLevel0Fail,    // CAS failures of linking level0 in add()
+  kLinkUpperFail,     // CAS failures of linking the upper levels in add()
+  kUnlinkFail,        // CAS failures of unlinking a flagged node
+  kFlagFail,          // CAS failures of flagging level0 in remove() or pops
+  kRestart,           // find() restarts from head_ because of a failed unlink
+  kMarkedSkip,        // flagged nodes skipped by the readers which do not unlink, e.g. contains()
+  kHelpingUnlink,     // successful unlinks of nodes which other keys' removers flagged, i.e. helping
+  kLevelTraversal,    // levels traversed by find()
+  kTraversalStep,     // nodes stepped by find() in all levels
+  kOpCounters,
+};
+
+struct OpStats {
+  int64_t link_level0_cas_fails = 0;
+  int64_t link_upper_cas_fails = 0;
+  int64_t unlink_cas_fails = 0;
+  int64_t flag_cas_fails = 0;
+  int64_t restarts = 0;
+  int64_t marked_skipped = 0;
+  int64_t helping_unlinks = 0;
+  int64_t level_traversals = 0;
+  int64_t traversal_steps = 0;
+
+  double avg_steps_per_level() const noexcept {
+    return level_traversals == 0 ? 0 : static_cast<double>(traversal_steps) / level_traversals;
+  }
+};
+
+template <bool Enabled>
+class OpStatsRecorder {
+public:
+  void count(OpCounter, int64_t = 1) noexcept {}
+
+  OpStats collect() const noexcept {
+    return OpStats();
+  }
+};
+
+template <>
+class OpStatsRecorder<true> {
+public:
+  OpStatsRecorder() : slots_(new Slot[ThreadSlot::kMaxThreads]) {}
+
+  void count(const OpCounter counter, const int64_t n = 1) noexcept {
+    auto& c = slots_[ThreadSlot::id()].counters[counter];
+    c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+  }
+
+  OpStats collect() const noexcept {
+    int64_t sums[kOpCounters] = {};
+    for (int i = 0, n = ThreadSlot::high_water(); i < n; ++i) {
+      for (int c = 0; c < kOpCounters; ++c) {
+        sums[c] += slots_[i].counters[c].load(std::memory_order_relaxed);
+      }
+    }
+
+    OpStats stats;
+    stats.link_level0_cas_fails = sums[kLinkLevel0Fail];
+    stats.link_upper_cas_fails = sums[kLinkUpperFail];
+    stats.unlink_cas_fails = sums[kUnlinkFail];
+    stats.flag_cas_fails = sums[kFlagFail];
+    stats.restarts = sums[kRestart];
+    stats.marked_skipped = sums[kMarkedSkip];
+    stats.helping_unlinks = sums[kHelpingUnlink];
+    stats.level_traversals = sums[kLevelTraversal];
+    stats.traversal_steps = sums[kTraversalStep];
+    return stats;
+  }
+
+private:
+  // padding to cache line to avoid false sharing between threads
+  struct alignas(64) Slot {
+    std::atomic<int64_t> counters[kOpCounters] = {};
+  };
+
+  std::unique_ptr<Slot[]> slots_;
+};
+
+} // namespace sss
@@ -0,0 +1,105 @@
+// string key with an inline order-preserving prefix for the sets, e.g. SkipSet<PrefixString> or LockFreeSkipSet<PrefixString>
+//
+// With std::string as the key, each comparison in a traversal chases the heap pointer of the string
+// (unless the string is short enough for SSO), i.e. one more cache miss for each node visited.
+// PrefixString keeps the first kPrefixBytes bytes of the string in an uint64_t in big-endian, padded by zero,
+// so comparing two prefixes as integers is the same order as comparing the bytes as unsigned char, like memcmp().
+// The prefix is the first member, so it is in the node next to the links, and the full string is only visited
+// when two prefixes are equal.
+//
+// PrefixStringView is the probe for heterogeneous lookup, e.g. contains(std::string_view), which computes the prefix
+// once and never allocates. The sets which support it check T::probe_type, check LockFreeSkipSet::contains().
+//
+// NOTE: the prefix helps only when the keys differ in the first 8 bytes.
+//       For keys with a long common prefix, e.g. "https://" of URLs or "tenant-0" of tenant ids,
+//       strip the common part before making the key, otherwise every comparison falls back to the full string.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <algorithm>
+#include <ostream>
+
+namespace sss {
+
+class PrefixStringView;
+
+namespace prefix_string_detail {
+
+constexpr std::size_t kPrefixBytes = sizeof(uint64_t);
+
+inline uint64_t prefix_of(const std::string_view s) noexcept {
+  uint64_t prefix = 0;
+  for (std::size_t i = 0, n = std::min(s.size(), kPrefixBytes); i < n; ++i) {
+    prefix |= static_cast<uint64_t>(static_cast<unsigned char>(s[i])) << (56 - 8*i);
+  }
+  return prefix;
+}
+
+// NOTE: std::string_view::compare() compares as unsigned char, the same order as the prefix
+template <class A, class B>
+int compare(const A& a, const B& b) noexcept {
+  if (a.prefix() != b.prefix())
+    return a.prefix() < b.prefix() ? -1 : 1;
+  return a.view().compare(b.view());
+}
+
+template <class A, class B>
+bool equal(const A& a, const B& b) noexcept {
+  return a.prefix() == b.prefix() && a.view() == b.view();
+}
+
+} // namespace prefix_string_detail
+
+class PrefixString {
+public:
+  using probe_type = PrefixStringView;
+
+  PrefixString() : prefix_(0) {}
+  PrefixString(std::string str) : prefix_(prefix_string_detail::prefix_of(str)), str_(std::move(str)) {}
+  PrefixString(const std::string_view str) : PrefixString(std::string(str)) {}
+  PrefixString(const char* const str) : PrefixString(std::string(str)) {}
+
+  uint64_t prefix() const noexcept { return prefix_; }
+  std::string_view view() const noexcept { return str_; }
+  const std::string& str() const noexcept { return str_; }
+
+private:
+  uint64_t prefix_;   // NOTE: the first member, compared before str_
+  std::string str_;
+};
+
+class PrefixStringView {
+public:
+  PrefixStringView(const std::string_view view) : prefix_(prefix_string_detail::prefix_of(view)), view_(view) {}
+
+  uint64_t prefix() const noexcept { return prefix_; }
+  std::string_view view() const noexcept { return view_; }
+
+private:
+  uint64_t prefix_;
+  std::string_view view_;
+};
+
+// all comparisons between PrefixString and PrefixStringView, which the sets use
+#define SSS_PREFIX_STRING_COMPARE(A, B) \
+  inline bool operator<(const A& a, const B& b) noexcept { return prefix_string_detail::compare(a, b) < 0; } \
+  inline bool operator>(const A& a, const B& b) noexcept { return prefix_string_detail::compare(a, b) > 0; } \
+  inline bool operator<=(const A& a, const B& b) noexcept { return prefix_string_detail::compare(a, b) <= 0; } \
+  inline bool operator>=(const A& a, const B& b) noexcept { return prefix_string_detail::compare(a, b) >= 0; } \
+  inline bool operator==(const A& a, const B& b) noexcept { return prefix_string_detail::equal(a, b); } \
+  inline bool operator!=(const A& a, const B& b) noexcept { return !prefix_string_detail::equal(a, b); }
+
+SSS_PREFIX_STRING_COMPARE(PrefixString, PrefixString)
+SSS_PREFIX_STRING_COMPARE(PrefixString, PrefixStringView)
+SSS_PREFIX_STRING_COMPARE(PrefixStringView, PrefixString)
+
+#undef SSS_PREFIX_STRING_COMPARE
+
+inline std::ostream& operator<<(std::ostream& os, const PrefixString& str) {
+  return os << str.str();
+}
+
+} // namespace sss
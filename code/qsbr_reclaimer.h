@@ -0,0 +1,156 @@
+// quiescent state based reclamation (QSBR) for the lock-free containers
+// reference: Thomas E. Hart etc., <<Performance of memory reclamation for lockless synchronization>>
+//
+// A thread announces a quiescent point by calling quiescent() when it holds no reference to any node,
+// e.g. at the end of each loop of an event-loop thread.
+// A node which has been unlinked is retired with a stamp from the global counter.
+// When every online thread has passed a quiescent point after the retirement, the node can be freed.
+//
+// Compared to EpochReclaimer, the operations of the container do nothing for reclamation,
+// so read paths have zero per-operation overhead. The cost is that the app must call quiescent()
+// regularly in every thread which visits the container, otherwise no retired node can be freed.
+// A thread which will not visit the container for a long time should call offline().
+//
+// NOTE: a thread becomes online automatically when it visits the container for the first time,
+//       and it is offline automatically when it exits.
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <cassert>
+
+#include "thread_slot.h"
+
+namespace sss {
+
+class QsbrReclaimer {
+public:
+  static constexpr bool kNeedValidation = false;
+
+  class Guard {
+  public:
+    explicit Guard(QsbrReclaimer& reclaimer) {
+      reclaimer.ensure_online();
+    }
+
+    void protect(const int, void* const) noexcept {}
+  };
+
+public:
+  QsbrReclaimer() : global_(kFirstStamp) {}
+
+  // when dtor(), no thread can be visiting the container, so all retired nodes can be freed
+  ~QsbrReclaimer() noexcept {
+    for (auto& record : records_) {
+      for (const auto& retired : record.retired) {
+        retired.deleter(retired.ptr, retired.context);
+      }
+    }
+  }
+
+  QsbrReclaimer(const QsbrReclaimer&) = delete;
+  QsbrReclaimer& operator=(const QsbrReclaimer&) = delete;
+
+  // the calling thread holds no reference to any node of the container
+  void quiescent() noexcept {
+    const int id = ThreadSlot::id();
+    auto& record = records_[id];
+    record.generation.store(ThreadSlot::generation(id), std::memory_order_relaxed);
+    record.seen.store(global_.load(std::memory_order_acquire), std::memory_order_release);
+
+    if (static_cast<int>(record.retired.size()) >= kRetireBatch)
+      collect(record);
+  }
+
+  // the calling thread will not visit the container until its next operation
+  void offline() noexcept {
+    auto& record = records_[ThreadSlot::id()];
+    record.seen.store(kOffline, std::memory_order_release);
+  }
+
+  // ptr must have been unlinked, i.e. no new reference to it can be acquired from now on.
+  // deleter(ptr, context) is called after every online thread has passed a quiescent point
+  void retire(void* const ptr, void (*deleter)(void*, void*), void* const context = nullptr) {
+    auto& record = records_[ThreadSlot::id()];
+    // any thread seeing a counter bigger than stamp passes its quiescent point after the retirement
+    const auto stamp = global_.fetch_add(1);
+    record.retired.push_back({ptr, deleter, context, stamp});
+
+    if (++record.since_collect >= kRetireBatch) {
+      record.since_collect = 0;
+      collect(record);
+    }
+  }
+
+private:
+  struct Retired {
+    void* ptr;
+    void (*deleter)(void*, void*);
+    void* context;
+    uint64_t stamp;
+  };
+
+  // padding to cache line to avoid false sharing between threads
+  struct alignas(64) Record {
+    std::atomic<uint64_t> seen{kOffline};   // the counter seen at the last quiescent point, kOffline if offline
+    std::atomic<unsigned> generation{0};    // ThreadSlot::generation() of the slot when the thread became online
+    int since_collect = 0;
+    std::vector<Retired> retired;           // ordered by stamp, only visited by the thread of the slot
+  };
+
+  // a new thread could reuse the slot of an exited thread, check the generation of the slot to know that
+  void ensure_online() noexcept {
+    const int id = ThreadSlot::id();
+    auto& record = records_[id];
+    const auto generation = ThreadSlot::generation(id);
+
+    if (record.seen.load(std::memory_order_relaxed) == kOffline ||
+        record.generation.load(std::memory_order_relaxed) != generation) {
+      record.generation.store(generation, std::memory_order_relaxed);
+      record.seen.store(global_.load(), std::memory_order_relaxed);
+      // being online must be visible before any node is read, pair with the loads in collect()
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+  }
+
+  // the minimum counter seen by all online threads
+  uint64_t min_seen() const noexcept {
+    auto min = global_.load();
+    for (int i = 0, hw = ThreadSlot::high_water(); i < hw; ++i) {
+      const auto& record = records_[i];
+      const auto seen = record.seen.load();
+      if (seen == kOffline)
+        continue;
+      if (record.generation.load() != ThreadSlot::generation(i))
+        continue;   // the thread has exited
+      if (seen < min)
+        min = seen;
+    }
+    return min;
+  }
+
+  // free nodes in batch which were retired before the quiescent points of all online threads
+  void collect(Record& record) noexcept {
+    const auto min = min_seen();
+    auto& retired = record.retired;
+
+    std::size_t safe = 0;
+    while (safe < retired.size() && retired[safe].stamp < min) {
+      retired[safe].deleter(retired[safe].ptr, retired[safe].context);
+      ++safe;
+    }
+    retired.erase(retired.begin(), retired.begin()+safe);
+  }
+
+private:
+  static constexpr uint64_t kOffline = 0;
+  static constexpr uint64_t kFirstStamp = 1;
+  static constexpr int kRetireBatch = 64;
+
+  alignas(64) std::atomic<uint64_t> global_;
+  Record records_[ThreadSlot::kMaxThreads];
+};
+
+} // namespace sss
@@ -0,0 +1,300 @@
+// range sharded concurrent set, i.e. N single-threaded SkipSet, each protected by a SpinLock
+//
+// bench_add_random_by_multi_skipset() in bench_lfss.cc shows that N SkipSet in N threads beat one LockFreeSkipSet,
+// check lock_free_vs_thread_lock.md for why: inside the critical section, the code runs like the single thread,
+// i.e. plain loads and stores in cache, and only the lock and unlock are atomic.
+// When the threads visit different shards, there is no contention, and the scaling is near linear.
+//
+// The keys are partitioned by ranges, not by hash, so the shards are in order and the whole set can be scanned in order.
+// shard i holds the keys in [splits[i-1], splits[i]), the first shard and the last shard are open at one end.
+// The split keys are chosen by the quantiles of a sample, e.g. the keys expected, or the towers of the shards in rebalance().
+//
+// The splits are in an immutable Layout. rebalance() moves a split by locking the two shards of it,
+// moving the keys between them, then publishing a new Layout and retiring the old one to an EpochReclaimer.
+// Each operation reads the Layout in a guard, locks the shard of the key, then checks the Layout is still the current one,
+// otherwise it retries, i.e. the shard could have lost the key range to its neighbour.
+//
+// NOTE: a hot range is still one shard, i.e. one lock, until rebalance() splits it,
+//       and rebalance() blocks the two shards of a split when it moves the keys.
+//       Call rebalance() from a background thread periodically, it does nothing if the shards are balanced.
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <cassert>
+
+#include "skipset.h"
+#include "skipset.cc"
+#include "spin_lock.h"
+#include "epoch_reclaimer.h"
+
+namespace sss {
+
+template <class T>
+class ShardedSkipSet {
+private:
+  // padding to cache line to avoid false sharing between the locks of the shards
+  struct alignas(64) Shard {
+    SpinLock lock;
+    SkipSet<T> set;
+    std::atomic<int> size{0};   // written under lock, read by size() without lock
+  };
+
+  struct Layout {
+    std::vector<T> splits;      // shard_num-1 split keys in ascending order
+
+    int shard_of(const T& key) const {
+      return static_cast<int>(std::upper_bound(splits.begin(), splits.end(), key) - splits.begin());
+    }
+  };
+
+public:
+  // the splits are the quantiles of sample, which need not be sorted.
+  // NOTE: an empty sample makes all splits T(), so the keys are in the first or the last shard until rebalance()
+  ShardedSkipSet(const int shard_num, std::vector<T> sample)
+    : shard_num_(shard_num), shards_(new Shard[shard_num]) {
+    assert(shard_num > 0);
+    std::sort(sample.begin(), sample.end());
+    auto* const layout = new Layout();
+    for (int i = 1; i < shard_num_; ++i) {
+      layout->splits.push_back(sample.empty() ? T() : sample[sample.size() * i / shard_num_]);
+    }
+    layout_.store(layout, std::memory_order_release);
+  }
+
+  // no thread can visit the set when dtor(), the retired layouts are freed by reclaimer_
+  ~ShardedSkipSet() noexcept {
+    delete layout_.load(std::memory_order_relaxed);
+  }
+
+  ShardedSkipSet(const ShardedSkipSet&) = delete;
+  ShardedSkipSet& operator=(const ShardedSkipSet&) = delete;
+
+  bool insert(const T& key) {
+    return with_shard(key, [&key](Shard& shard) {
+      const bool inserted = shard.set.insert(key);
+      shard.size.store(shard.set.size(), std::memory_order_relaxed);
+      return inserted;
+    });
+  }
+
+  bool erase(const T& key) {
+    return with_shard(key, [&key](Shard& shard) {
+      const bool erased = shard.set.erase(key);
+      shard.size.store(shard.set.size(), std::memory_order_relaxed);
+      return erased;
+    });
+  }
+
+  bool contains(const T& key) const {
+    return with_shard(key, [&key](Shard& shard) {
+      return shard.set.contains(key);
+    });
+  }
+
+  // the sum of the shards, not a snapshot when there are concurrent writers
+  int size() const {
+    int size = 0;
+    for (int i = 0; i < shard_num_; ++i) {
+      size += shards_[i].size.load(std::memory_order_relaxed);
+    }
+    return size;
+  }
+
+  std::vector<int> shard_sizes() const {
+    std::vector<int> sizes;
+    for (int i = 0; i < shard_num_; ++i) {
+      sizes.push_back(shards_[i].size.load(std::memory_order_relaxed));
+    }
+    return sizes;
+  }
+
+  // visit all keys in ascending order by visitor(const T& key), return the number of keys visited.
+  // One shard is locked at a time, so the consistency is like ScanMode::kWeak of LockFreeSkipSet,
+  // each key visited was in the set during the scan, and no key is visited twice even when rebalance() moves keys.
+  // NOTE: visitor is called under the lock of a shard, so it must not visit the set
+  template <class Visitor>
+  int for_each(Visitor visitor) const {
+    return visit(nullptr, nullptr, visitor);
+  }
+
+  // visit keys in [lo, hi] in ascending order, check for_each()
+  template <class Visitor>
+  int scan(const T& lo, const T& hi, Visitor visitor) const {
+    return visit(&lo, &hi, visitor);
+  }
+
+  // move the splits to the quantiles of the keys if the biggest shard is more than kMaxSkew times of the average.
+  // The quantiles are estimated by the towers of each shard, check SkipSet::sample(),
+  // then each split is moved toward its target between its two neighbour splits, left to right and right to left,
+  // so the keys flow in both directions. Return the number of splits moved.
+  // NOTE: only one rebalance() at a time, concurrent callers wait
+  int rebalance() {
+    std::lock_guard<std::mutex> serial(rebalance_mutex_);
+
+    const auto sizes = shard_sizes();
+    const int total = std::max(1, size());
+    if (*std::max_element(sizes.begin(), sizes.end()) * shard_num_ <= total * kMaxSkew)
+      return 0;
+
+    const auto targets = sample_splits();
+    if (targets.empty())
+      return 0;
+
+    int moved = 0;
+    for (int i = 0; i < shard_num_-1; ++i) {
+      if (move_split(i, targets[i]))
+        ++moved;
+    }
+    for (int i = shard_num_-2; i >= 0; --i) {
+      if (move_split(i, targets[i]))
+        ++moved;
+    }
+    return moved;
+  }
+
+private:
+  // lock the shard of key by the current layout, then call f(shard)
+  template <class F>
+  auto with_shard(const T& key, F f) const {
+    EpochReclaimer::Guard guard(reclaimer_);
+    while (true) {
+      const Layout* const layout = layout_.load(std::memory_order_acquire);
+      Shard& shard = shards_[layout->shard_of(key)];
+      std::lock_guard<SpinLock> lock(shard.lock);
+      // rebalance() publishes the layout under the locks of the shards it changes,
+      // so if the layout is the same, the shard still owns the key
+      if (layout_.load(std::memory_order_acquire) == layout)
+        return f(shard);
+    }
+  }
+
+  // from the shard of lo, visit its keys and then continue from its upper split by the layout of that time.
+  // The next shard is found by the split, not the index, because the layout could change between two shards
+  template <class Visitor>
+  int visit(const T* const lo, const T* const hi, Visitor& visitor) const {
+    EpochReclaimer::Guard guard(reclaimer_);
+    int cnt = 0;
+    T from;
+    const T* start = lo;
+
+    while (true) {
+      const Layout* const layout = layout_.load(std::memory_order_acquire);
+      const int index = start == nullptr ? 0 : layout->shard_of(*start);
+      Shard& shard = shards_[index];
+      {
+        std::lock_guard<SpinLock> lock(shard.lock);
+        if (layout_.load(std::memory_order_acquire) != layout)
+          continue;
+
+        const auto end = shard.set.end();
+        for (auto it = start == nullptr ? shard.set.begin() : shard.set.lower_bound(*start); it != end; ++it) {
+          const T key = *it;
+          if (hi != nullptr && *hi < key)
+            return cnt;
+          visitor(key);
+          ++cnt;
+        }
+      }
+
+      if (index == shard_num_-1 || (hi != nullptr && *hi < layout->splits[index]))
+        return cnt;
+      from = layout->splits[index];
+      start = &from;
+    }
+  }
+
+  // estimate the quantiles of all keys by the towers of the shards.
+  // The sample of a shard is the towers higher than a level, so each key sampled stands for 2^level keys
+  std::vector<T> sample_splits() const {
+    std::vector<std::pair<T, int64_t>> sample;    // key and its weight, in ascending order
+    int64_t total = 0;
+    for (int i = 0; i < shard_num_; ++i) {
+      std::lock_guard<SpinLock> lock(shards_[i].lock);
+      int level = 0;
+      while ((shards_[i].set.size() >> level) > kSampleKeys)
+        ++level;
+      shards_[i].set.sample(level, [&](const T& key) {
+        sample.emplace_back(key, int64_t(1) << level);
+        total += int64_t(1) << level;
+      });
+    }
+
+    std::vector<T> targets;
+    if (sample.empty())
+      return targets;
+
+    int64_t acc = 0;
+    std::size_t pos = 0;
+    for (int i = 1; i < shard_num_; ++i) {
+      while (pos+1 < sample.size() && acc + sample[pos].second <= total * i / shard_num_) {
+        acc += sample[pos].second;
+        ++pos;
+      }
+      targets.push_back(sample[pos].first);
+    }
+    return targets;
+  }
+
+  // move the split i, i.e. between shard i and shard i+1, toward target, but not beyond the neighbour splits
+  bool move_split(const int i, T target) {
+    std::lock_guard<SpinLock> left_lock(shards_[i].lock);     // NOTE: lock from left to right, no deadlock
+    std::lock_guard<SpinLock> right_lock(shards_[i+1].lock);
+
+    const Layout* const layout = layout_.load(std::memory_order_relaxed);    // only rebalance() changes it
+    const auto& splits = layout->splits;
+    if (i > 0 && target < splits[i-1])
+      target = splits[i-1];
+    if (i+1 < shard_num_-1 && splits[i+1] < target)
+      target = splits[i+1];
+    if (!(target < splits[i]) && !(splits[i] < target))
+      return false;
+
+    if (target < splits[i]) {
+      move_keys(shards_[i], shards_[i+1], target, splits[i]);
+    } else {
+      move_keys(shards_[i+1], shards_[i], splits[i], target);
+    }
+
+    auto* const new_layout = new Layout(*layout);
+    new_layout->splits[i] = target;
+    layout_.store(new_layout, std::memory_order_release);
+    reclaimer_.retire(const_cast<Layout*>(layout), delete_layout);
+    return true;
+  }
+
+  // move the keys in [lo, hi) from src to dst, both are locked by the caller
+  static void move_keys(Shard& src, Shard& dst, const T& lo, const T& hi) {
+    std::vector<T> keys;
+    const auto end = src.set.end();
+    for (auto it = src.set.lower_bound(lo); it != end && *it < hi; ++it) {
+      keys.push_back(*it);
+    }
+    for (const auto& key : keys) {
+      src.set.erase(key);
+      dst.set.insert(key);
+    }
+    src.size.store(src.set.size(), std::memory_order_relaxed);
+    dst.size.store(dst.set.size(), std::memory_order_relaxed);
+  }
+
+  static void delete_layout(void* const layout, void* const) {
+    delete static_cast<Layout*>(layout);
+  }
+
+private:
+  static constexpr int kMaxSkew = 2;
+  static constexpr int kSampleKeys = 256;   // about the number of keys sampled in each shard
+
+  const int shard_num_;
+  std::unique_ptr<Shard[]> shards_;
+  std::atomic<const Layout*> layout_;
+  std::mutex rebalance_mutex_;
+  mutable EpochReclaimer reclaimer_;    // mutable because contains() const needs a guard
+};
+
+} // namespace sss
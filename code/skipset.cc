@@ -1,23 +1,25 @@
+#pragma once
+
 #include <random>
+#include <cstring>
+#include <ctime>
+#include <cassert>
 
 #include "skipset.h"
 
 namespace sss { // sss is simple skip set or single-threaded skip set
 
 template<class T>
-SkipSet<T>::SkipSet(): head_(nullptr), height_(0), count_(0) {
+SkipSet<T>::SkipSet(): head_(nullptr), height_(0), count_(0), slab_(kMaxHeight) {
     std::srand(std::time(0));
     head_ = create_node(kMaxHeight, T());
 }
 
+// the memory of all nodes is freed by slab_, so only destroy the keys
 template<class T>
 SkipSet<T>::~SkipSet() noexcept {
-  auto* node = head_;
-  while (node)
-  {
-    auto* to_destroy = node;
-    node = node->next[0];
-    destroy_node(to_destroy);
+  for (auto* node = head_; node; node = node->next[0]) {
+    node->key.~T();
   }
 }
 
@@ -31,9 +33,20 @@ bool SkipSet<T>::empty() const {
   return count_ == 0;
 }
 
+template<class T>
+int SkipSet<T>::size() const {
+  return count_;
+}
+
 template<class T>
 bool SkipSet<T>::contains(const T& key) const {
-  return find(key) != end();
+  return find_node(key) != nullptr;
+}
+
+template<class T>
+template<class K, class U, class Probe>
+bool SkipSet<T>::contains(const K& key) const {
+  return find_node(Probe(key)) != nullptr;
 }
 
 template<class T>
@@ -93,16 +106,18 @@ bool SkipSet<T>::erase(const T& key) {
   if (!(find && find->key == key))
     return false;
 
-  // can be eraaed
+  // can be eraaed, the levels unlinked are the height of the node
+  int find_height = 0;
   for (int level = 0; level < height_; level++) {
     if (preds[level]->next[level] != find)
       break;
     preds[level]->next[level] = find->next[level];
+    ++find_height;
   }
   while (height_ > 0 && head_->next[height_-1] == nullptr)
     --height_;
 
-  destroy_node(find);
+  destroy_node(find, find_height);
   --count_;
   return true;
 }
@@ -119,6 +134,42 @@ typename sss::SkipSet<T>::Iterator sss::SkipSet<T>::end() const {
 
 template<class T>
 typename sss::SkipSet<T>::Iterator sss::SkipSet<T>::find(const T& key) const {
+  return Iterator(find_node(key));
+}
+
+template<class T>
+typename sss::SkipSet<T>::Iterator sss::SkipSet<T>::lower_bound(const T& key) const {
+  const Node* node = head_;
+  for (int level = height_-1; level >= 0; --level)
+  {
+    while (node->next[level] && node->next[level]->key < key) {
+      node = node->next[level];
+    }
+  }
+  return Iterator(node->next[0]);
+}
+
+template<class T>
+template<class F>
+void sss::SkipSet<T>::sample(const int level, F f) const {
+  if (level >= height_)
+    return;
+
+  for (const Node* node = head_->next[level]; node; node = node->next[level]) {
+    f(node->key);
+  }
+}
+
+template<class T>
+template<class K, class U, class Probe>
+typename sss::SkipSet<T>::Iterator sss::SkipSet<T>::find(const K& key) const {
+  return Iterator(find_node(Probe(key)));
+}
+
+// the node of key, or nullptr
+template<class T>
+template<class K>
+const typename sss::SkipSet<T>::Node* sss::SkipSet<T>::find_node(const K& key) const {
   const Node* node = head_;
   for (int level = height_-1; level >= 0; --level)
   {
@@ -129,9 +180,9 @@ typename sss::SkipSet<T>::Iterator sss::SkipSet<T>::find(const T& key) const {
     
   const auto* const find = node->next[0];
   if (find && find->key == key) {
-    return Iterator(find);
+    return find;
   } else {
-    return end();
+    return nullptr;
   }
 }
 
@@ -145,7 +196,7 @@ template<class T>
 typename SkipSet<T>::Node* SkipSet<T>::create_node(const int height, T&& new_key) const {
   assert(height > 0 && height <= kMaxHeight);
 
-  void* node_mem = std::malloc(sizeof(Node)+(height-1)*sizeof(Node*));
+  void* node_mem = slab_.allocate(height);
   Node* new_node = static_cast<Node*>(node_mem);
   new (&new_node->key) T(new_key);
   for (int level = 0; level < height; ++level) {
@@ -156,9 +207,9 @@ typename SkipSet<T>::Node* SkipSet<T>::create_node(const int height, T&& new_key
 }
 
 template<class T>
-void SkipSet<T>::destroy_node(Node* node) const noexcept {
+void SkipSet<T>::destroy_node(Node* node, const int height) const noexcept {
   node->key.~T();
-  std::free(node);
+  slab_.deallocate(node, height);
 }
 
 // return rand level in [1, kMaxHeight]
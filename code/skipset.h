@@ -2,6 +2,8 @@
 
 #pragma once
 
+#include "slab_allocator.h"
+
 namespace sss { // sss is simple skip set or single-threaded skip set
 
 template <class T>
@@ -14,6 +16,11 @@ private:
     // NOTE: we will allocate memory in place after value for contigoous layout, 
     // check create_node() & destroy_node()
     Node* next[1];   
+
+    // the bytes of the node with the tower, for SlabAllocator
+    static std::size_t size_of(const int height) {
+      return sizeof(Node) + (height-1)*sizeof(Node*);
+    }
   };
 
   class Iterator {
@@ -48,17 +55,31 @@ public:
   SkipSet& operator=(const SkipSet&) = delete;
 
   bool empty() const;
+  int size() const;
   bool insert(const T& key);
   bool erase(const T& key);
   Iterator begin() const;
   Iterator end() const;
   Iterator find(const T& key) const;
   bool contains(const T& key) const;
+  // the first key not less than key, or end()
+  Iterator lower_bound(const T& key) const;
+  // visit the keys of the towers higher than level in order by f(const T& key), 
+  // i.e. a sample of about 1/2^level of all keys in O(size/2^level), e.g. choosing split points
+  template <class F>
+  void sample(const int level, F f) const;
+  // heterogeneous lookup if T has a probe_type, e.g. std::string_view for PrefixString, check prefix_string.h
+  template <class K, class U = T, class Probe = typename U::probe_type>
+  Iterator find(const K& key) const;
+  template <class K, class U = T, class Probe = typename U::probe_type>
+  bool contains(const K& key) const;
 
 private:
+  template <class K>
+  const Node* find_node(const K& key) const;
   Node* create_node(const int height, const T& new_key) const;
   Node* create_node(const int height, T&& new_key) const;
-  void destroy_node(Node* node) const noexcept;
+  void destroy_node(Node* node, const int height) const noexcept;
   int random_height() const;
   
 private:
@@ -68,6 +89,9 @@ private:
 
   const int kMaxHeight = 32;
   const float kProbability = 0.5;
+
+  // NOTE: after kMaxHeight which initializes it, and mutable because create_node() is const
+  mutable SlabAllocator<Node> slab_;
 };
 
 
@@ -0,0 +1,147 @@
+// single-threaded slab allocator for the nodes of SkipSet and ASkipSet, one size class for each height of tower
+//
+// A node is a tower of variable size, i.e. its links are allocated in place after the node like NodePool,
+// so Node must have the static member function std::size_t size_of(const int height)
+//
+// Each height has its own free list and its own slabs, i.e. big blocks from ::operator new(),
+// and a new node is cut from the current slab of its height one after another,
+// so the nodes inserted one by one, e.g. in sorted order, are adjacent in memory,
+// and there is no malloc() metadata between them.
+// The slabs of a height double in size from kMinSlabBlocks blocks up to kMaxSlabBytes,
+// so a small set does not pay a big slab for each height, and a big set needs few allocations.
+//
+// A freed block is pushed to the free list of its height, and reused first by the next node of the height.
+// The slabs are only freed when the allocator is destroyed.
+//
+// The block of a node is aligned like NodePool, i.e. to the smallest power of two which is not less than its size,
+// up to a cache line, so a small node never straddles two cache lines and a big node starts from a cache line.
+//
+// NOTE: no thread safety, it is owned by one single-threaded set.
+
+#pragma once
+
+#include <vector>
+#include <new>
+#include <algorithm>
+#include <functional>
+#include <cstddef>
+#include <cassert>
+
+namespace sss {
+
+template <class Node>
+class SlabAllocator {
+public:
+  explicit SlabAllocator(const int max_height) : classes_(max_height+1) {
+    for (int height = 1; height <= max_height; ++height) {
+      classes_[height].block_size = block_size(height);
+    }
+  }
+
+  ~SlabAllocator() noexcept {
+    for (const auto& slab : slabs_) {
+      ::operator delete(static_cast<void*>(slab), std::align_val_t(kCacheLineSize));
+    }
+  }
+
+  SlabAllocator(const SlabAllocator&) = delete;
+  SlabAllocator& operator=(const SlabAllocator&) = delete;
+
+  // raw memory of Node::size_of(height) bytes, the caller constructs the node in it
+  void* allocate(const int height) {
+    assert(height > 0 && height < static_cast<int>(classes_.size()));
+    auto& size_class = classes_[height];
+
+    if (size_class.free_list != nullptr) {
+      FreeBlock* const block = size_class.free_list;
+      size_class.free_list = block->next;
+      return block;
+    }
+
+    if (size_class.cursor == size_class.end)
+      new_slab(size_class);
+
+    void* const block = size_class.cursor;
+    size_class.cursor += size_class.block_size;
+    return block;
+  }
+
+  // mem must be from allocate() with the same height, and the node in it has been destroyed
+  void deallocate(void* const mem, const int height) noexcept {
+    assert(height > 0 && height < static_cast<int>(classes_.size()));
+    auto& size_class = classes_[height];
+    FreeBlock* const block = static_cast<FreeBlock*>(mem);
+    block->next = size_class.free_list;
+    size_class.free_list = block;
+  }
+
+  // sort each free list by address, so the next nodes of a height reuse the freed blocks from the low address up,
+  // e.g. ASkipSet erases a batch of keys then inserts them again in order, and they are adjacent again
+  void sort_free_lists() {
+    std::vector<FreeBlock*> blocks;
+    for (auto& size_class : classes_) {
+      blocks.clear();
+      for (FreeBlock* block = size_class.free_list; block != nullptr; block = block->next) {
+        blocks.push_back(block);
+      }
+      std::sort(blocks.begin(), blocks.end(), std::greater<FreeBlock*>());
+      size_class.free_list = nullptr;
+      for (FreeBlock* const block : blocks) {
+        block->next = size_class.free_list;
+        size_class.free_list = block;
+      }
+    }
+  }
+
+  // the bytes of all slabs, including the free blocks and the blocks not cut yet
+  std::size_t memory_bytes() const noexcept {
+    return memory_bytes_;
+  }
+
+private:
+  struct FreeBlock {
+    FreeBlock* next;
+  };
+
+  struct SizeClass {
+    std::size_t block_size = 0;
+    std::size_t slab_blocks = kMinSlabBlocks;   // the blocks of the next slab
+    char* cursor = nullptr;                      // the next block to cut from the current slab
+    char* end = nullptr;
+    FreeBlock* free_list = nullptr;
+  };
+
+  static std::size_t block_size(const int height) {
+    const std::size_t size = std::max(Node::size_of(height), sizeof(FreeBlock));
+    if (size >= kCacheLineSize)
+      return (size + kCacheLineSize-1) / kCacheLineSize * kCacheLineSize;
+
+    std::size_t block = 1;
+    while (block < size)
+      block <<= 1;
+    return block;
+  }
+
+  void new_slab(SizeClass& size_class) {
+    const std::size_t bytes = size_class.slab_blocks * size_class.block_size;
+    char* const mem = static_cast<char*>(::operator new(bytes, std::align_val_t(kCacheLineSize)));
+    slabs_.push_back(mem);
+    memory_bytes_ += bytes;
+
+    size_class.cursor = mem;
+    size_class.end = mem + bytes;
+    if (bytes * 2 <= kMaxSlabBytes)
+      size_class.slab_blocks *= 2;
+  }
+
+private:
+  static constexpr std::size_t kCacheLineSize = 64;
+  static constexpr std::size_t kMinSlabBlocks = 16;
+  static constexpr std::size_t kMaxSlabBytes = 1 << 20;
+
+  std::vector<SizeClass> classes_;   // classes_[height]
+  std::vector<char*> slabs_;
+  std::size_t memory_bytes_ = 0;
+};
+
+} // namespace sss
@@ -0,0 +1,55 @@
+// a test-and-test-and-set spin lock for short critical sections, e.g. one operation of a single-threaded SkipSet
+//
+// std::mutex parks the thread in the kernel under contention, which costs more than the critical section
+// when it is only a few hundred nanoseconds. The waiters spin on a plain load, so they share the cache line
+// in read mode until the owner releases it, and only then race for the exchange.
+//
+// It is BasicLockable, so it works with std::lock_guard and std::unique_lock.
+// NOTE: no fairness and no sleeping, so do not hold it for long or across blocking calls.
+//       The owner being preempted stalls all waiters, i.e. more threads than cores hurts,
+//       the waiters yield after kSpinLimit pauses to mitigate it.
+
+#pragma once
+
+#include <atomic>
+#include <thread>
+
+#include "contention_manager.h"
+
+namespace sss {
+
+class SpinLock {
+public:
+  SpinLock() = default;
+  SpinLock(const SpinLock&) = delete;
+  SpinLock& operator=(const SpinLock&) = delete;
+
+  void lock() noexcept {
+    while (locked_.exchange(true, std::memory_order_acquire)) {
+      int spins = 0;
+      while (locked_.load(std::memory_order_relaxed)) {
+        if (++spins < kSpinLimit) {
+          cpu_pause();
+        } else {
+          std::this_thread::yield();
+          spins = 0;
+        }
+      }
+    }
+  }
+
+  bool try_lock() noexcept {
+    return !locked_.load(std::memory_order_relaxed) && !locked_.exchange(true, std::memory_order_acquire);
+  }
+
+  void unlock() noexcept {
+    locked_.store(false, std::memory_order_release);
+  }
+
+private:
+  static constexpr int kSpinLimit = 1024;
+
+  std::atomic<bool> locked_{false};
+};
+
+} // namespace sss
@@ -0,0 +1,82 @@
+// bounded lock-free ring buffer for exactly one producer thread and one consumer thread
+//
+// The producer only writes tail_ and the consumer only writes head_, each in its own cache line,
+// so there is no CAS, a push or a pop is one release store.
+// Each side keeps a cached copy of the other's index, and only reads the other's cache line
+// when the cached one says the ring is full (for the producer) or empty (for the consumer).
+// consume() takes a batch of items and publishes head_ once for the whole batch.
+//
+// NOTE: the capacity is rounded up to the power of two, and the indices are never wrapped,
+//       i.e. 64 bits of index do not overflow in practice.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+
+namespace sss {
+
+template <class T>
+class SpscRing {
+public:
+  explicit SpscRing(const std::size_t capacity) {
+    std::size_t cap = 1;
+    while (cap < capacity)
+      cap <<= 1;
+    mask_ = cap - 1;
+    items_ = std::make_unique<T[]>(cap);
+  }
+
+  SpscRing(const SpscRing&) = delete;
+  SpscRing& operator=(const SpscRing&) = delete;
+
+  std::size_t capacity() const noexcept {
+    return mask_ + 1;
+  }
+
+  // producer only, return false if the ring is full
+  bool try_push(const T& item) {
+    const uint64_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - cached_head_ > mask_) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      if (tail - cached_head_ > mask_)
+        return false;
+    }
+    items_[tail & mask_] = item;
+    tail_.store(tail+1, std::memory_order_release);
+    return true;
+  }
+
+  // consumer only, call f(const T& item) for at most max items in order, return the number of items consumed
+  template <class F>
+  std::size_t consume(const std::size_t max, F f) {
+    const uint64_t head = head_.load(std::memory_order_relaxed);
+    if (head == cached_tail_) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      if (head == cached_tail_)
+        return 0;
+    }
+
+    const std::size_t n = static_cast<std::size_t>(cached_tail_ - head) < max ?
+                          static_cast<std::size_t>(cached_tail_ - head) : max;
+    for (std::size_t i = 0; i < n; ++i) {
+      f(items_[(head+i) & mask_]);
+    }
+    head_.store(head+n, std::memory_order_release);   // the slots can be reused by the producer after it
+    return n;
+  }
+
+private:
+  std::unique_ptr<T[]> items_;
+  std::size_t mask_;
+
+  alignas(64) std::atomic<uint64_t> tail_{0};   // written by the producer
+  uint64_t cached_head_ = 0;                    // the producer's copy of head_
+
+  alignas(64) std::atomic<uint64_t> head_{0};   // written by the consumer
+  uint64_t cached_tail_ = 0;                    // the consumer's copy of tail_
+};
+
+} // namespace sss
@@ -0,0 +1,72 @@
+// striped counter for the lock-free containers
+//
+// A single std::atomic<int> counter updated by all threads bounces its cache line between cores,
+// check thread_with_align.cc for the cost of false sharing.
+// Here each thread updates its own stripe, which is padded to a cache line, so the update is nearly local.
+// The stripe is chosen by ThreadSlot::id(), so threads more than kStripes share stripes, which is still correct.
+//
+// The read aggregates all stripes, so it is much slower than the update. There are two modes of read
+// 1. sum(), exact when no update is in progress, it reads all stripes
+// 2. approximate(), O(1). When fold_threshold > 0, a stripe folds its value into a shared total
+//    when its absolute value reaches fold_threshold, so approximate() reads the total only,
+//    and the error is less than kStripes * fold_threshold.
+//
+// NOTE: without folding, each stripe of a counter which is only increased is monotonic,
+//       so two equal sums mean no stripe changed between them. LockFreeSkipSet uses it for ScanMode::kPointInTime.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <algorithm>
+
+#include "thread_slot.h"
+
+namespace sss {
+
+enum class SizeMode {
+  kExact,
+  kApproximate,
+};
+
+class StripedCounter {
+public:
+  explicit StripedCounter(const int64_t fold_threshold = 0) : fold_threshold_(fold_threshold) {}
+
+  StripedCounter(const StripedCounter&) = delete;
+  StripedCounter& operator=(const StripedCounter&) = delete;
+
+  void add(const int64_t delta, const std::memory_order order = std::memory_order_relaxed) noexcept {
+    auto& stripe = stripes_[ThreadSlot::id() & (kStripes-1)];
+    const auto value = stripe.value.fetch_add(delta, order) + delta;
+
+    if (fold_threshold_ > 0 && (value >= fold_threshold_ || value <= -fold_threshold_))
+      total_.fetch_add(stripe.value.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+  }
+
+  int64_t sum(const std::memory_order order = std::memory_order_relaxed) const noexcept {
+    int64_t sum = 0;
+    for (int i = 0, n = std::min(kStripes, ThreadSlot::high_water()); i < n; ++i) {
+      sum += stripes_[i].value.load(order);
+    }
+    return sum + total_.load(std::memory_order_relaxed);
+  }
+
+  int64_t approximate() const noexcept {
+    return total_.load(std::memory_order_relaxed);
+  }
+
+private:
+  // padding to cache line to avoid false sharing between threads
+  struct alignas(64) Stripe {
+    std::atomic<int64_t> value{0};
+  };
+
+  static constexpr int kStripes = 64;   // NOTE: must be power of 2
+
+  const int64_t fold_threshold_;
+  alignas(64) std::atomic<int64_t> total_{0};
+  Stripe stripes_[kStripes];
+};
+
+} // namespace sss
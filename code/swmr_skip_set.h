@@ -0,0 +1,232 @@
+// single-writer/multi-reader skip set, i.e. SkipSet for one writer thread and any number of reader threads
+// reference: the MemTable SkipList of LevelDB, https://github.com/google/leveldb/blob/main/db/skiplist.h
+//
+// The writer runs the same algorithms as SkipSet, so insert() and erase() need no lock and no CAS,
+// and the readers take no lock and write no shared data
+// 1. insert() fills the links of the new node first, then publishes it in preds[level]->nexts[level]
+//    by release stores from level0 up, so a reader which sees the new node by an acquire load sees its key and links.
+//    A reader can see the new node in a lower level but not yet in a higher one, which only makes its search a bit longer.
+// 2. erase() unlinks the node from the top level down by release stores, the links of the erased node are kept,
+//    so a reader standing on it can go on, and the node is retired to Reclaimer instead of being freed.
+// 3. height_ and count_ are only written by the writer, a reader which sees an old height_ only walks more or fewer levels.
+//
+// With EpochReclaimer, a read is one store and one fence on the record of its own thread,
+// with QsbrReclaimer, a read writes nothing, and each reader calls quiescent() between its reads, check qsbr_reclaimer.h
+//
+// NOTE: insert() and erase() must be called by one thread at a time, e.g. the owner thread of the index,
+//       or under a lock of the writers. Readers can call contains(), lower_bound() and for_each() concurrently.
+
+#pragma once
+
+#include <atomic>
+#include <algorithm>
+#include <new>
+#include <cassert>
+
+#include "memory_order.h"
+#include "epoch_reclaimer.h"
+#include "qsbr_reclaimer.h"
+#include "leak_reclaimer.h"
+#include "node_pool.h"
+#include "thread_random.h"
+
+namespace sss {
+
+template <class T, class Reclaimer = EpochReclaimer>
+class SwmrSkipSet {
+  static_assert(!Reclaimer::kNeedValidation, "SwmrSkipSet does not support reclaimer which needs validation");
+
+private:
+  // the links of all levels are allocated in place after the node like SkipSet::Node, check NodePool
+  struct Node {
+    T key;
+    const int height;
+    std::atomic<Node*> nexts[1];    // NOTE: the real size is height
+
+    static std::size_t size_of(const int height) {
+      return sizeof(Node) + (height-1)*sizeof(std::atomic<Node*>);
+    }
+
+    static Node* construct(void* const mem, const int height) {
+      assert(height > 0);
+      return new (mem) Node(height);
+    }
+
+    static void destroy(Node* const node) noexcept {
+      node->~Node();
+    }
+
+    // a node from NodePool could be recycled, reset it to be a new one
+    void reset(const T& k) {
+      key = k;
+      for (int level = 0; level < height; ++level) {
+        nexts[level].store(nullptr, std::memory_order_relaxed);
+      }
+    }
+
+  private:
+    explicit Node(const int h) : key(), height(h), nexts{nullptr} {
+      for (int level = 1; level < height; ++level) {
+        new (&nexts[level]) std::atomic<Node*>(nullptr);
+      }
+    }
+
+    ~Node() noexcept = default;
+  };
+
+public:
+  SwmrSkipSet() : height_(0), count_(0), pool_(kMaxHeight) {
+    head_ = pool_.acquire(kMaxHeight);
+  }
+
+  // no thread can visit the set when dtor(), all nodes are freed by pool_,
+  // and reclaimer_ returns the retired nodes to pool_ before that
+  ~SwmrSkipSet() noexcept = default;
+
+  SwmrSkipSet(const SwmrSkipSet&) = delete;
+  SwmrSkipSet& operator=(const SwmrSkipSet&) = delete;
+
+  int size() const {
+    return count_.load(std::memory_order_relaxed);
+  }
+
+  bool empty() const {
+    return size() == 0;
+  }
+
+  // check QsbrReclaimer
+  void quiescent() {
+    reclaimer_.quiescent();
+  }
+
+  void offline() {
+    reclaimer_.offline();
+  }
+
+  // writer only
+  bool insert(const T& key) {
+    Node* preds[kMaxHeight];
+    const int height = height_.load(std::memory_order_relaxed);
+    Node* const find = find_preds(key, height, preds);
+    if (find != nullptr && find->key == key)
+      return false;
+
+    const int new_height = random_height();
+    for (int level = height; level < new_height; ++level) {
+      preds[level] = head_;
+    }
+
+    Node* const new_node = pool_.acquire(new_height);
+    new_node->reset(key);
+    for (int level = 0; level < new_height; ++level) {
+      new_node->nexts[level].store(preds[level]->nexts[level].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    for (int level = 0; level < new_height; ++level) {
+      preds[level]->nexts[level].store(new_node, std::memory_order_release);
+    }
+    // NOTE: raised after the links, so a reader which sees the new height_ sees the new node in head_ of those levels
+    if (new_height > height)
+      height_.store(new_height, std::memory_order_release);
+
+    count_.store(count_.load(std::memory_order_relaxed)+1, std::memory_order_relaxed);
+    return true;
+  }
+
+  // writer only
+  bool erase(const T& key) {
+    Node* preds[kMaxHeight];
+    int height = height_.load(std::memory_order_relaxed);
+    Node* const find = find_preds(key, height, preds);
+    if (find == nullptr || find->key != key)
+      return false;
+
+    for (int level = find->height-1; level >= 0; --level) {
+      preds[level]->nexts[level].store(find->nexts[level].load(std::memory_order_relaxed), std::memory_order_release);
+    }
+    while (height > 0 && head_->nexts[height-1].load(std::memory_order_relaxed) == nullptr)
+      --height;
+    height_.store(height, std::memory_order_relaxed);
+
+    count_.store(count_.load(std::memory_order_relaxed)-1, std::memory_order_relaxed);
+    reclaimer_.retire(find, recycle_node, &pool_);
+    return true;
+  }
+
+  // reader, or the writer
+  bool contains(const T& key) const {
+    typename Reclaimer::Guard guard(reclaimer_);
+    const Node* const node = lower_bound_node(key);
+    return node != nullptr && node->key == key;
+  }
+
+  // the first key not less than key into result, return false if no such key
+  bool lower_bound(const T& key, T& result) const {
+    typename Reclaimer::Guard guard(reclaimer_);
+    const Node* const node = lower_bound_node(key);
+    if (node == nullptr)
+      return false;
+    result = node->key;
+    return true;
+  }
+
+  // visit the keys in order by f(const T& key), the keys inserted or erased during it could be visited or not
+  template <class F>
+  void for_each(F f) const {
+    typename Reclaimer::Guard guard(reclaimer_);
+    for (const Node* node = head_->nexts[0].load(std::memory_order_acquire); node != nullptr;
+         node = node->nexts[0].load(std::memory_order_acquire)) {
+      f(node->key);
+    }
+  }
+
+private:
+  // writer only, so relaxed loads see its own stores. Fill preds of the levels below height, return the succ in level0
+  Node* find_preds(const T& key, const int height, Node* preds[]) const {
+    Node* node = head_;
+    for (int level = height-1; level >= 0; --level) {
+      Node* next = node->nexts[level].load(std::memory_order_relaxed);
+      while (next != nullptr && next->key < key) {
+        node = next;
+        next = node->nexts[level].load(std::memory_order_relaxed);
+      }
+      preds[level] = node;
+    }
+    return height > 0 ? preds[0]->nexts[0].load(std::memory_order_relaxed) : nullptr;
+  }
+
+  // in a Guard, acquire loads pair with the release stores of the writer.
+  // NOTE: return the next checked in level0 instead of loading node->nexts[0] again,
+  //       which could be a node less than key inserted by the writer in between
+  const Node* lower_bound_node(const T& key) const {
+    const Node* node = head_;
+    const Node* next = nullptr;
+    for (int level = height_.load(std::memory_order_acquire)-1; level >= 0; --level) {
+      next = node->nexts[level].load(std::memory_order_acquire);
+      while (next != nullptr && next->key < key) {
+        node = next;
+        next = node->nexts[level].load(std::memory_order_acquire);
+      }
+    }
+    return next;
+  }
+
+  int random_height() const {
+    return ThreadRandom::geometric_height(kMaxHeight);
+  }
+
+  static void recycle_node(void* const node, void* const pool) {
+    auto* const n = static_cast<Node*>(node);
+    static_cast<NodePool<Node>*>(pool)->release(n, n->height);
+  }
+
+private:
+  static constexpr int kMaxHeight = 32;
+
+  Node* head_;
+  std::atomic<int> height_;      // written by the writer only
+  std::atomic<int> count_;       // written by the writer only
+  NodePool<Node> pool_;          // NOTE: pool_ must be destroyed after reclaimer_ which returns nodes to it
+  mutable Reclaimer reclaimer_;  // mutable because contains() const needs a guard
+};
+
+} // namespace sss
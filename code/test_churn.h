@@ -0,0 +1,72 @@
+// shared helpers of the churn tests of the lock-free containers, e.g. test_lfss.cc, test_lock_free_double_link_list.cc
+// and test_stress.h
+//
+// CountedKey counts the living keys, so a test can check that the removed nodes are reclaimed during the churn
+// and that all nodes are freed after dtor().
+
+#pragma once
+
+#include <atomic>
+#include <random>
+#include <type_traits>
+#include <utility>
+
+// key type which counts the living objects, so we can check the nodes are reclaimed
+struct CountedKey {
+  static inline std::atomic<int> alive{0};
+  int val;
+
+  CountedKey() : val(0) { ++alive; }
+  CountedKey(const int v) : val(v) { ++alive; }
+  CountedKey(const CountedKey& copy) : val(copy.val) { ++alive; }
+  CountedKey& operator=(const CountedKey& rhs) = default;
+  ~CountedKey() { --alive; }
+
+  bool operator<(const CountedKey& rhs) const { return val < rhs.val; }
+  bool operator>=(const CountedKey& rhs) const { return val >= rhs.val; }
+  bool operator==(const CountedKey& rhs) const { return val == rhs.val; }
+};
+
+// report a quiescent state or go offline for QsbrReclaimer, a no-op for the sets without them
+template <class Set, class = void>
+struct HasQuiescent : std::false_type {};
+
+template <class Set>
+struct HasQuiescent<Set, std::void_t<decltype(std::declval<Set&>().quiescent()),
+                                     decltype(std::declval<Set&>().offline())>> : std::true_type {};
+
+template <class Set>
+void quiescent(Set& set) {
+  if constexpr (HasQuiescent<Set>::value)
+    set.quiescent();
+}
+
+template <class Set>
+void offline(Set& set) {
+  if constexpr (HasQuiescent<Set>::value)
+    set.offline();
+}
+
+// one step of the churn: add or remove a random key in [0, bound), then look up a random key
+template <class Set>
+void churn_op(std::mt19937& g, const int bound, Set& set) {
+  const int num = g() % bound;
+  if (g() % 2 == 0) {
+    set.add(num);
+  } else {
+    set.remove(num);
+  }
+  set.contains(g() % bound);
+}
+
+// the thread function of the churn, it reports quiescent every 64 steps for QsbrReclaimer
+template <class Set>
+void churn_f(const int seed, const int ops, const int bound, Set& set) {
+  std::mt19937 g(seed);
+  for (int i = 0; i < ops; ++i) {
+    churn_op(g, bound, set);
+
+    if (i % 64 == 0)
+      quiescent(set);
+  }
+}
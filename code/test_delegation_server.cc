@@ -0,0 +1,89 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <set>
+#include <cassert>
+
+#include "skipset.h"
+#include "skipset.cc"
+#include "vectskipset.h"
+#include "vectskipset.cc"
+#include "spsc_ring.h"
+#include "delegation_server.h"
+#include "test_model.h"
+
+// the consumer sees the items in the order of the producer, in batches of any size
+void test_spsc_ring() {
+  constexpr int n = 1 << 20;
+  sss::SpscRing<int> ring(64);
+  assert(ring.capacity() == 64);
+
+  std::thread producer([&ring]() {
+    for (int i = 0; i < n; ++i) {
+      while (!ring.try_push(i))
+        std::this_thread::yield();
+    }
+  });
+
+  int expected = 0;
+  while (expected < n) {
+    // yield when empty like the producer when full, otherwise one core spins its whole time slice for each batch
+    if (ring.consume(7, [&expected](const int item) { assert(item == expected); ++expected; }) == 0)
+      std::this_thread::yield();
+  }
+  producer.join();
+  assert(ring.consume(1, [](const int) { assert(false); }) == 0);
+  std::cout << "test_spsc_ring ok\n";
+}
+
+// each client thread owns its keys, check test_model.h, so it knows the result of each request.
+// Half of the requests are posted in batches, then waited by tickets
+template <class Set>
+void test_delegation(const char* name) {
+  using Server = sss::DelegationServer<Set>;
+  constexpr int client_num = 4;
+  constexpr int ops = 1 << 11;   // the long run is bench_delegation_cmp() in bench_lfss.cc
+  constexpr int batch = 16;
+  constexpr int range = 512;
+  Server server(batch);
+
+  const std::set<int> all = run_owned(client_num, range, [&server](OwnedModel& model) {
+    auto client = server.connect();
+    for (int n = 0; n < ops; n += batch) {
+      std::vector<std::pair<uint64_t, bool>> expected;
+      for (int i = 0; i < batch; ++i) {
+        ModelOp op;
+        int key;
+        const bool result = model.next(op, key);
+        if (op == ModelOp::kInsert) {
+          expected.emplace_back(client.post(Server::kInsert, key), result);
+        } else if (op == ModelOp::kErase) {
+          expected.emplace_back(client.post(Server::kErase, key), result);
+        } else {
+          expected.emplace_back(client.post(Server::kContains, key), result);
+        }
+      }
+      for (const auto& [ticket, result] : expected)
+        assert(client.wait(ticket) == result);
+
+      const int key = model.key();
+      assert(client.contains(key) == (model.keys().count(key) == 1));
+    }
+  });
+
+  // a new client reuses a channel, and sees all the keys
+  auto client = server.connect();
+  for (int key = 0; key < range * client_num; ++key)
+    assert(client.contains(key) == (all.count(key) == 1));
+  std::cout << "test_delegation for " << name << " ok\n";
+}
+
+int main() {
+  test_spsc_ring();
+
+  test_delegation<sss::SkipSet<int>>("SkipSet");
+
+  test_delegation<sss::VectSkipSet<int>>("VectSkipSet");
+
+  return 0;
+}
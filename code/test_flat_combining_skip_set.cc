@@ -0,0 +1,55 @@
+#include <iostream>
+#include <thread>
+#include <random>
+#include <vector>
+#include <set>
+#include <cassert>
+
+#include "flat_combining_skip_set.h"
+#include "test_model.h"
+
+void test_basic() {
+  sss::FlatCombiningSkipSet<int> fcss;
+  std::mt19937 g(2023);
+  std::set<int> expected;
+  for (int i = 0; i < 10000; ++i) {
+    const int key = g() % 1000;
+    const int action = g() % 3;
+    if (action == 0) {
+      assert(fcss.insert(key) == expected.insert(key).second);
+    } else if (action == 1) {
+      assert(fcss.erase(key) == (expected.erase(key) == 1));
+    } else {
+      assert(fcss.contains(key) == (expected.count(key) == 1));
+    }
+  }
+  assert(fcss.size() == static_cast<int>(expected.size()));
+
+  std::vector<int> keys;
+  fcss.for_each([&keys](const int key) { keys.push_back(key); });
+  assert(keys == std::vector<int>(expected.begin(), expected.end()));
+  std::cout << "test_basic ok\n";
+}
+
+// each thread owns its keys, check test_model.h, and each request is applied by whichever thread is the combiner
+void test_concurrent() {
+  sss::FlatCombiningSkipSet<int> fcss;
+  const auto all = test_owned(fcss, 8, 1 << 15, 1024,
+                              [](auto& set, const int key) { return set.insert(key); },
+                              [](auto& set, const int key) { return set.erase(key); },
+                              [](auto& set, const int key) { return set.contains(key); });
+
+  std::vector<int> keys;
+  fcss.for_each([&keys](const int key) { keys.push_back(key); });
+  assert(keys == std::vector<int>(all.begin(), all.end()));
+  assert(fcss.avg_batch() >= 1.0);
+  std::cout << "test_concurrent ok, size = " << fcss.size() << ", avg batch = " << fcss.avg_batch() << '\n';
+}
+
+int main() {
+  test_basic();
+
+  test_concurrent();
+
+  return 0;
+}
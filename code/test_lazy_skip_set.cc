@@ -0,0 +1,62 @@
+#include <iostream>
+#include <random>
+#include <vector>
+#include <set>
+#include <cassert>
+
+#include "lazy_skip_set.h"
+#include "test_model.h"
+#include "test_stress.h"
+
+void test_basic() {
+  sss::LazySkipSet<int> lss;
+  std::mt19937 g(2023);
+  std::set<int> expected;
+  for (int i = 0; i < 100000; ++i) {
+    const int key = g() % 1000;
+    const int action = g() % 3;
+    if (action == 0) {
+      assert(lss.add(key) == expected.insert(key).second);
+    } else if (action == 1) {
+      assert(lss.remove(key) == (expected.erase(key) == 1));
+    } else {
+      assert(lss.contains(key) == (expected.count(key) == 1));
+    }
+  }
+  assert(lss.size() == static_cast<int>(expected.size()));
+  for (int key = 0; key < 1000; ++key)
+    assert(lss.contains(key) == (expected.count(key) == 1));
+  std::cout << "test_basic ok\n";
+}
+
+// each thread owns its keys, check test_model.h, while the towers of the threads interleave and share the preds
+void test_concurrent() {
+  sss::LazySkipSet<int> lss;
+  const auto all = test_owned(lss, 8, 1 << 16, 256,
+                              [](auto& set, const int key) { return set.add(key); },
+                              [](auto& set, const int key) { return set.remove(key); },
+                              [](auto& set, const int key) { return set.contains(key); });
+  std::cout << "test_concurrent ok, size = " << all.size() << '\n';
+}
+
+// all threads add and remove the same few keys besides their own ones, check the invariants in test_stress.h
+void test_contended() {
+  constexpr int thread_num = 8;
+  sss::LazySkipSet<int> lss;
+  Counters counters;
+  std::vector<std::vector<bool>> owned(thread_num, std::vector<bool>(kOwnedKeys, false));
+  run_stress(lss, thread_num, 1 << 15, counters, owned);
+
+  const int size = check_and_count(lss, counters, owned);
+  std::cout << "test_contended ok, size = " << size << '\n';
+}
+
+int main() {
+  test_basic();
+
+  test_concurrent();
+
+  test_contended();
+
+  return 0;
+}
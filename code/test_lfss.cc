@@ -3,8 +3,12 @@
 #include <algorithm>
 #include <thread>
 #include <chrono>
+#include <atomic>
+#include <type_traits>
+#include <string>
 
 #include "lock_free_skip_set.h"
+#include "test_churn.h"
 
 void simple_test() {
   std::vector<int> nums;
@@ -153,6 +157,328 @@ void test_iterator() {
   std::cout << '\n';
 }
 
+// the same seed gives the same heights, and the heights are geometric with p = 0.5
+void test_seeded_height() {
+  constexpr int max_height = 32;
+  constexpr int n = 1 << 16;
+
+  sss::ThreadRandom::seed(2023);
+  std::vector<int> heights(n);
+  for (auto& h : heights)
+    h = sss::ThreadRandom::geometric_height(max_height);
+
+  sss::ThreadRandom::seed(2023);
+  std::vector<int> cnts(max_height+1, 0);
+  for (const auto h : heights) {
+    assert(h == sss::ThreadRandom::geometric_height(max_height));
+    assert(h >= 1 && h <= max_height);
+    ++cnts[h];
+  }
+
+  for (int h = 1; h <= 4; ++h) {
+    const int expected = n >> h;
+    assert(cnts[h] > expected * 9 / 10 && cnts[h] < expected * 11 / 10);
+  }
+  assert(sss::ThreadRandom::geometric_height(1) == 1);
+}
+
+// add_batch() of sorted keys, with existing keys, duplicates, unsorted input and concurrent batches
+void test_add_batch() {
+  sss::LockFreeSkipSet<int> lfss;
+  for (int i = 0; i < 1000; i += 3) 
+    lfss.add(i);
+
+  std::vector<int> batch;
+  for (int i = 0; i < 1000; ++i) {
+    batch.push_back(i);
+    if (i % 7 == 0)
+      batch.push_back(i);   // duplicate
+  }
+  int added = lfss.add_batch(batch.begin(), batch.end());
+  assert(added == 1000 - 334);
+  assert(lfss.size() == 1000);
+
+  std::vector<int> unsorted{2000, 1500, 1999, 1500, 3};
+  added = lfss.add_batch(unsorted.begin(), unsorted.end());
+  assert(added == 3);
+
+  // each thread adds a sorted batch of keys i, i+thread_num, ... while other threads remove some of them
+  constexpr int thread_num = 4;
+  constexpr int bound = 1 << 16;
+  sss::LockFreeSkipSet<int> concurrent;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < thread_num; ++t) {
+    threads.push_back(std::thread([&concurrent, t]() {
+      std::vector<int> keys;
+      for (int k = t; k < bound; k += thread_num)
+        keys.push_back(k);
+      concurrent.add_batch(keys.begin(), keys.end());
+      for (int k = t; k < bound; k += thread_num * 2)
+        concurrent.remove(k);
+    }));
+  }
+  for (auto& th : threads) 
+    th.join();
+
+  int last = -1;
+  int cnt = 0;
+  for (auto it = concurrent.begin(); it != concurrent.end(); ++it) {
+    assert(*it > last);
+    assert((*it) % (thread_num * 2) >= thread_num);
+    last = *it;
+    ++cnt;
+  }
+  assert(cnt == bound / 2 && concurrent.size() == cnt);
+  // each stripe keeps less than the fold threshold, check StripedCounter
+  assert(cnt - concurrent.size(sss::SizeMode::kApproximate) < 64 * 32);
+}
+
+void test_scan() {
+  using CountedSet = sss::LockFreeSkipSet<int, sss::EpochReclaimer, sss::NoBackoff, sss::NoHashIndex, sss::WriteCounter>;
+  CountedSet lfss;
+  for (int i = 0; i < 100; i += 2)
+    lfss.add(i);
+  lfss.remove(50);
+
+  std::vector<int> keys;
+  int cnt = lfss.scan(45, 60, [&keys](const int key) { keys.push_back(key); });
+  assert(cnt == 7 && keys == std::vector<int>({46, 48, 52, 54, 56, 58, 60}));
+  assert(lfss.count_range(45, 60, sss::ScanMode::kPointInTime) == 7);
+  assert(lfss.count_range(-10, 1000) == 49);
+  assert(lfss.count_range(61, 61) == 0);
+  assert(lfss.count_range(200, 300) == 0);
+
+  // writers keep moving a key from one half of the set to the other half,
+  // so a point-in-time scan always sees exactly half of the keys
+  constexpr int pairs = 256;
+  CountedSet moving;
+  for (int i = 0; i < pairs; ++i)
+    moving.add(i);
+
+  std::atomic<bool> stop{false};
+  std::vector<std::thread> writers;
+  for (int t = 0; t < 2; ++t) {
+    writers.push_back(std::thread([&moving, &stop, t]() {
+      // each writer owns the pairs of (i, i+pairs) for i % 2 == t, and moves i to i+pairs or back
+      std::mt19937 g(t);
+      while (!stop.load()) {
+        const int i = (g() % (pairs/2)) * 2 + t;
+        if (moving.remove(i)) {
+          moving.add(i + pairs);
+        } else if (moving.remove(i + pairs)) {
+          moving.add(i);
+        }
+      }
+    }));
+  }
+
+  for (int r = 0; r < 200; ++r) {
+    const int cnt = moving.count_range(0, pairs*2, sss::ScanMode::kPointInTime);
+    assert(cnt == pairs || cnt == pairs-1 || cnt == pairs-2);   // at most one move in progress for each writer
+  }
+  stop.store(true);
+  for (auto& th : writers)
+    th.join();
+}
+
+void test_pop_min() {
+  sss::LockFreeSkipSet<int> lfss;
+  assert(!lfss.peek_min().has_value() && !lfss.try_pop_min().has_value());
+  for (const int key : {5, 3, 9, 1, 7})
+    lfss.add(key);
+
+  assert(*lfss.peek_min() == 1);
+  assert(*lfss.try_pop_min() == 1);
+  assert(*lfss.try_pop_min() == 3);
+  lfss.remove(5);
+  assert(*lfss.peek_min() == 7);
+  assert(lfss.size() == 2);
+
+  // concurrent poppers pop each key exactly once, and each popper sees its keys in ascending order
+  constexpr int thread_num = 4;
+  constexpr int bound = 1 << 15;
+  sss::LockFreeSkipSet<int> pq;
+  for (int i = 0; i < bound; ++i)
+    pq.add(i);
+
+  std::vector<std::vector<int>> popped(thread_num);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < thread_num; ++t) {
+    threads.push_back(std::thread([&pq, &popped, t]() {
+      while (auto key = pq.try_pop_min()) {
+        assert(popped[t].empty() || popped[t].back() < *key);
+        popped[t].push_back(*key);
+      }
+    }));
+  }
+  for (auto& th : threads)
+    th.join();
+
+  std::vector<bool> seen(bound, false);
+  for (const auto& keys : popped) {
+    for (const auto key : keys) {
+      assert(!seen[key]);
+      seen[key] = true;
+    }
+  }
+  assert(std::count(seen.begin(), seen.end(), true) == bound);
+  assert(pq.empty());
+}
+
+// spray poppers also pop each key exactly once, even when the set becomes small at the end
+void test_spray_pop() {
+  constexpr int thread_num = 8;
+  constexpr int bound = 1 << 15;
+  sss::LockFreeSkipSet<int> pq;
+  for (int i = 0; i < bound; ++i)
+    pq.add(i);
+
+  sss::SprayParams params;
+  params.threads = thread_num;
+  std::vector<std::vector<int>> popped(thread_num);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < thread_num; ++t) {
+    threads.push_back(std::thread([&pq, &popped, &params, t]() {
+      while (auto key = pq.spray_pop(params)) {
+        popped[t].push_back(*key);
+      }
+    }));
+  }
+  for (auto& th : threads)
+    th.join();
+
+  std::vector<bool> seen(bound, false);
+  for (const auto& keys : popped) {
+    for (const auto key : keys) {
+      assert(!seen[key]);
+      seen[key] = true;
+    }
+  }
+  assert(std::count(seen.begin(), seen.end(), true) == bound);
+  assert(pq.empty() && !pq.spray_pop(params).has_value());
+}
+
+// build it with -DSSS_OP_STATS to check the statistics, otherwise they must be all zero
+void test_op_stats() {
+  static_assert(std::is_empty_v<sss::OpStatsRecorder<false>>);
+
+  constexpr int thread_num = 8;
+  constexpr int bound = 64;
+  sss::LockFreeSkipSet<int> lfss;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < thread_num; ++t) {
+    threads.push_back(std::thread([&lfss, t]() {
+      std::mt19937 g(t);
+      for (int i = 0; i < (1 << 15); ++i) {
+        const int num = g() % bound;
+        if (g() % 2 == 0) {
+          lfss.add(num);
+        } else {
+          lfss.remove(num);
+        }
+      }
+    }));
+  }
+  for (auto& th : threads)
+    th.join();
+
+  const auto stats = lfss.stats();
+  std::cout << "test_op_stats, enabled = " << sss::kOpStats;
+  std::cout << ", link level0 fails = " << stats.link_level0_cas_fails << ", link upper fails = " << stats.link_upper_cas_fails;
+  std::cout << ", unlink fails = " << stats.unlink_cas_fails << ", flag fails = " << stats.flag_cas_fails;
+  std::cout << ", restarts = " << stats.restarts << ", marked skipped = " << stats.marked_skipped;
+  std::cout << ", helping unlinks = " << stats.helping_unlinks << ", avg steps per level = " << stats.avg_steps_per_level() << '\n';
+  if (sss::kOpStats) {
+    assert(stats.level_traversals > 0 && stats.traversal_steps > 0);
+  } else {
+    assert(stats.level_traversals == 0 && stats.traversal_steps == 0 && stats.helping_unlinks == 0);
+  }
+}
+
+// with the hash index, contains() must be the same as without it, even when the index is too small to hold all keys.
+// Each thread owns the keys of key % thread_num == t, so it knows whether its keys are in the set
+// while others churn the index slots around them
+void test_hash_index() {
+  using IndexedSet = sss::LockFreeSkipSet<int, sss::EpochReclaimer, sss::NoBackoff, sss::HashIndex<>>;
+
+  for (const std::size_t capacity : {std::size_t(16), std::size_t(0)}) {
+    IndexedSet lfss(capacity);
+    assert(lfss.index_memory() >= capacity * sizeof(void*));
+    for (int i = 0; i < 1024; ++i)
+      assert(lfss.add(i));
+    for (int i = 0; i < 1024; i += 2)
+      assert(lfss.remove(i));
+    for (int i = 0; i < 1024; ++i)
+      assert(lfss.contains(i) == (i % 2 == 1));
+
+    constexpr int thread_num = 4;
+    constexpr int bound = 1 << 12;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_num; ++t) {
+      threads.push_back(std::thread([&lfss, t]() {
+        std::mt19937 g(t);
+        std::vector<bool> mine(bound, false);
+        for (int i = t; i < 1024; i += thread_num)
+          mine[i] = i % 2 == 1;
+        for (int n = 0; n < (1 << 16); ++n) {
+          const int key = (g() % (bound/thread_num)) * thread_num + t;
+          if (g() % 2 == 0) {
+            assert(lfss.add(key) == !mine[key]);
+            mine[key] = true;
+          } else {
+            assert(lfss.remove(key) == mine[key]);
+            mine[key] = false;
+          }
+          assert(lfss.contains(key) == mine[key]);
+          const int other = g() % bound;
+          if (other % thread_num == t)
+            assert(lfss.contains(other) == mine[other]);
+          else
+            lfss.contains(other);
+        }
+      }));
+    }
+    for (auto& th : threads)
+      th.join();
+  }
+
+  // the default hash of HashIndex<> is std::hash of the key type
+  sss::LockFreeSkipSet<std::string, sss::EpochReclaimer, sss::NoBackoff, sss::HashIndex<>> strs;
+  for (int i = 0; i < 256; ++i)
+    assert(strs.add("key" + std::to_string(i)));
+  for (int i = 0; i < 256; ++i)
+    assert(strs.contains("key" + std::to_string(i)) && !strs.contains("absent" + std::to_string(i)));
+  std::cout << "test_hash_index ok\n";
+}
+
+template <class Reclaimer>
+void test_reclaim_under_churn() {
+  constexpr int thread_num = 8;
+  constexpr int bound = 1 << 10;
+  constexpr int ops = 1 << 18;
+  constexpr int rounds = 4;
+
+  {
+    sss::LockFreeSkipSet<CountedKey, Reclaimer> lfss;
+    for (int r = 0; r < rounds; ++r) {
+      std::vector<std::thread> threads;
+      for (int i = 0; i < thread_num; ++i) {
+        threads.push_back(std::thread(churn_f<sss::LockFreeSkipSet<CountedKey, Reclaimer>>, r*thread_num+i, ops, bound,
+                                      std::ref(lfss)));
+      }
+      for (auto& th : threads) {
+        th.join();
+      }
+      // without reclamation, alive keys grow with total removes, i.e. millions
+      std::cout << "round " << r << ", size = " << lfss.size() << ", alive keys = " << CountedKey::alive << '\n';
+      assert(CountedKey::alive < bound * 64);
+    }
+  }
+
+  std::cout << "alive keys after dtor = " << CountedKey::alive << '\n';
+  assert(CountedKey::alive == 0);
+}
+
 int main() {
   // test_thread_insert();
 
@@ -160,5 +486,23 @@ int main() {
 
   test_iterator();
 
+  test_seeded_height();
+
+  test_add_batch();
+
+  test_scan();
+
+  test_pop_min();
+
+  test_spray_pop();
+
+  test_op_stats();
+
+  test_hash_index();
+
+  test_reclaim_under_churn<sss::EpochReclaimer>();
+
+  test_reclaim_under_churn<sss::QsbrReclaimer>();
+
   return 0;
 }
\ No newline at end of file
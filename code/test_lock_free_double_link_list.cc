@@ -0,0 +1,154 @@
+#include <iostream>
+#include <thread>
+#include <random>
+#include <vector>
+#include <atomic>
+#include <cassert>
+
+#include "lock_free_double_link_list.h"
+#include "test_churn.h"
+
+void test_cursor() {
+  sss::LockFreeDoubleLinkList<int> lfdll;
+  assert(!lfdll.first().valid() && !lfdll.last().valid());
+
+  for (const int key : {5, 1, 9, 3, 7})
+    assert(lfdll.add(key));
+  assert(!lfdll.add(3));
+  assert(lfdll.size() == 5);
+
+  // forward and backward
+  std::vector<int> keys;
+  for (auto c = lfdll.first(); c.valid(); ++c)
+    keys.push_back(*c);
+  assert((keys == std::vector<int>{1, 3, 5, 7, 9}));
+  keys.clear();
+  for (auto c = lfdll.last(); c.valid(); --c)
+    keys.push_back(*c);
+  assert((keys == std::vector<int>{9, 7, 5, 3, 1}));
+
+  // edits at a cursor
+  auto c = lfdll.seek(4);
+  assert(*c == 5);
+  assert(lfdll.insert_before(c, 4) && *c == 4);
+  assert(lfdll.insert_after(c, 6) && *c == 6);    // the ordered position is after 5
+  assert(!lfdll.insert_after(c, 6) && !lfdll.insert_after(c, 2));
+  assert(!lfdll.insert_before(c, 8) && !lfdll.insert_before(c, 5));
+  --c;
+  assert(*c == 5);
+  assert(lfdll.erase(c) && *c == 6);
+  --c;
+  assert(*c == 4);
+  assert(!lfdll.contains(5) && lfdll.contains(4) && lfdll.contains(6));
+
+  // insert at the ends
+  auto e = lfdll.last();
+  ++e;
+  assert(!e.valid() && lfdll.insert_before(e, 10) && *e == 10);
+  auto b = lfdll.first();
+  --b;
+  assert(!b.valid() && lfdll.insert_after(b, 0) && *b == 0);
+
+  keys.clear();
+  for (auto c = lfdll.last(); c.valid(); --c)
+    keys.push_back(*c);
+  assert((keys == std::vector<int>{10, 9, 7, 6, 4, 3, 1, 0}));
+  assert(lfdll.size() == 8);
+  assert(lfdll.remove(10) && !lfdll.remove(10));
+  assert(*lfdll.last() == 9);
+  std::cout << "test_cursor ok\n";
+}
+
+// writers add and remove by keys and by cursors, while readers go backward and forward,
+// the keys a reader visits must be strictly ordered in the direction.
+// Run with -fsanitize=address to check no node is freed when another thread visits it by a prev link
+template <class Reclaimer>
+void test_concurrent_churn() {
+  constexpr int writer_num = 4;
+  constexpr int reader_num = 2;
+  constexpr int bound = 256;
+  constexpr int ops = 1 << 16;
+
+  {
+    sss::LockFreeDoubleLinkList<CountedKey, Reclaimer> lfdll;
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < writer_num; ++i) {
+      threads.push_back(std::thread([&lfdll, i]() {
+        std::mt19937 g(i);
+        for (int n = 0; n < ops; ++n) {
+          const int action = g() % 4;
+          if (action < 2) {
+            churn_op(g, bound, lfdll);
+          } else {
+            auto c = lfdll.seek(g() % bound);
+            if (c.valid()) {
+              if (action == 2) {
+                lfdll.insert_before(c, CountedKey((*c).val - 1));
+              } else {
+                lfdll.erase(c);
+              }
+            }
+          }
+          if (n % 64 == 0)
+            lfdll.quiescent();
+        }
+        lfdll.offline();
+      }));
+    }
+    for (int i = 0; i < reader_num; ++i) {
+      threads.push_back(std::thread([&lfdll, &stop, i]() {
+        while (!stop.load()) {
+          if (i % 2 == 0) {
+            int last = bound;
+            for (auto c = lfdll.last(); c.valid(); --c) {
+              assert((*c).val < last);
+              last = (*c).val;
+            }
+          } else {
+            int last = -bound;
+            for (auto c = lfdll.first(); c.valid(); ++c) {
+              assert((*c).val > last);
+              last = (*c).val;
+            }
+          }
+          lfdll.quiescent();
+        }
+        lfdll.offline();
+      }));
+    }
+    for (int i = 0; i < writer_num; ++i) {
+      threads[i].join();
+    }
+    stop = true;
+    for (int i = writer_num; i < writer_num + reader_num; ++i) {
+      threads[i].join();
+    }
+
+    // forward and backward are the same, and match size() and contains()
+    std::vector<int> forward;
+    for (auto c = lfdll.first(); c.valid(); ++c)
+      forward.push_back((*c).val);
+    std::vector<int> backward;
+    for (auto c = lfdll.last(); c.valid(); --c)
+      backward.push_back((*c).val);
+    assert(std::vector<int>(backward.rbegin(), backward.rend()) == forward);
+    assert(static_cast<int64_t>(forward.size()) == lfdll.size());
+    for (const int key : forward)
+      assert(lfdll.contains(key));
+    std::cout << "test_concurrent_churn, size = " << lfdll.size() << ", alive keys = " << CountedKey::alive << '\n';
+  }
+  assert(CountedKey::alive == 0);
+}
+
+int main() {
+  test_cursor();
+
+  test_concurrent_churn<sss::EpochReclaimer>();
+
+  test_concurrent_churn<sss::QsbrReclaimer>();
+
+  test_concurrent_churn<sss::LeakReclaimer>();
+
+  return 0;
+}
@@ -1,4 +1,8 @@
+#include <thread>
+#include <cassert>
+
 #include "lock_free_set_link_list.h"
+#include "test_churn.h"
 
 void add_3_2_1() {
   sss::LockFreeSetLinkList<int> lfsll;
@@ -53,6 +57,29 @@ void test_memory_leak() {
   lfsll.remove(2);
 }
 
+// concurrent add/remove/contains, the unlinked nodes are freed by the reclaimer during the run.
+// Run with -fsanitize=address to check no node is freed when another thread visits it
+template <class Reclaimer>
+void test_concurrent_churn() {
+  sss::LockFreeSetLinkList<int, Reclaimer> lfsll;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.push_back(std::thread(churn_f<sss::LockFreeSetLinkList<int, Reclaimer>>, i, 1<<16, 64, std::ref(lfsll)));
+  }
+  for (auto& th : threads) {
+    th.join();
+  }
+
+  // contains() is const for the readers, though it could help to unlink with hazard pointers
+  const auto& reader = lfsll;
+  int count = 0;
+  for (int i = 0; i < 64; ++i) {
+    if (reader.contains(i)) ++count;
+  }
+  assert(count == lfsll.size());
+  std::cout << "test_concurrent_churn, size = " << lfsll.size() << '\n';
+}
+
 int main() {
   add_3_2_1();
 
@@ -62,5 +89,11 @@ int main() {
 
   test_memory_leak();
 
+  test_concurrent_churn<sss::HazardPointerDomain>();
+
+  test_concurrent_churn<sss::EpochReclaimer>();
+
+  test_concurrent_churn<sss::QsbrReclaimer>();
+
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,189 @@
+#include <iostream>
+#include <thread>
+#include <random>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <cassert>
+
+#include "lock_free_skip_map.h"
+
+void simple_test() {
+  sss::LockFreeSkipMap<int, std::string> lfsm;
+  assert(lfsm.put_if_absent(1, "one"));
+  assert(lfsm.put_if_absent(3, "three"));
+  assert(!lfsm.put_if_absent(1, "uno"));
+  assert(lfsm.size() == 2);
+
+  assert(*lfsm.get(1) == "one");
+  assert(!lfsm.get(2).has_value());
+
+  assert(lfsm.replace(1, "uno"));
+  assert(*lfsm.get(1) == "uno");
+  assert(!lfsm.replace(2, "two"));
+
+  assert(lfsm.compute(3, [](const std::string& v) { return v + "!"; }));
+  assert(*lfsm.get(3) == "three!");
+
+  assert(lfsm.remove(1));
+  assert(!lfsm.remove(1));
+  assert(!lfsm.contains(1));
+  assert(!lfsm.compute(1, [](const std::string& v) { return v; }));
+  assert(lfsm.size() == 1);
+
+  assert(lfsm.put_if_absent(1, "one again"));
+  assert(*lfsm.get(1) == "one again");
+  std::cout << "simple_test ok\n";
+}
+
+// every thread increments the counters of all keys by compute(),
+// no increment can be lost because compute() is an atomic read-modify-write in place
+void test_concurrent_compute() {
+  constexpr int thread_num = 8;
+  constexpr int keys = 16;
+  constexpr int rounds = 1 << 12;
+
+  sss::LockFreeSkipMap<int, long> lfsm;
+  for (int k = 0; k < keys; ++k) {
+    lfsm.put_if_absent(k, 0);
+  }
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < thread_num; ++i) {
+    threads.push_back(std::thread([&lfsm]() {
+      for (int r = 0; r < rounds; ++r) {
+        for (int k = 0; k < keys; ++k) {
+          lfsm.compute(k, [](const long v) { return v + 1; });
+        }
+        lfsm.quiescent();
+      }
+      lfsm.offline();
+    }));
+  }
+  for (auto& th : threads) {
+    th.join();
+  }
+
+  for (int k = 0; k < keys; ++k) {
+    assert(*lfsm.get(k) == static_cast<long>(thread_num) * rounds);
+  }
+  std::cout << "test_concurrent_compute ok\n";
+}
+
+// value type which counts the living objects, so we can check the boxes are reclaimed
+struct CountedValue {
+  static inline std::atomic<int> alive{0};
+  int val;
+
+  CountedValue(const int v) : val(v) { ++alive; }
+  CountedValue(const CountedValue& copy) : val(copy.val) { ++alive; }
+  ~CountedValue() { --alive; }
+};
+
+// threads put, replace and remove in a small key range,
+// a value of key k is always k * 1000 + something, so get() never returns a value of another key.
+// Backoff is applied on every failed CAS of the links and of the values, check contention_manager.h
+template <class Backoff>
+void test_concurrent_churn() {
+  constexpr int thread_num = 8;
+  constexpr int bound = 64;
+  constexpr int ops = 1 << 16;
+
+  {
+    sss::LockFreeSkipMap<int, CountedValue, sss::EpochReclaimer, Backoff> lfsm;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < thread_num; ++i) {
+      threads.push_back(std::thread([&lfsm, i]() {
+        std::mt19937 g(i);
+        for (int n = 0; n < ops; ++n) {
+          const int key = g() % bound;
+          const int action = g() % 4;
+          if (action == 0) {
+            lfsm.put_if_absent(key, CountedValue(key*1000));
+          } else if (action == 1) {
+            lfsm.remove(key);
+          } else if (action == 2) {
+            lfsm.replace(key, CountedValue(key*1000 + n%1000));
+          } else {
+            const auto v = lfsm.get(key);
+            assert(!v.has_value() || v->val / 1000 == key);
+          }
+          if (n % 64 == 0)
+            lfsm.quiescent();
+        }
+        lfsm.offline();
+      }));
+    }
+    for (auto& th : threads) {
+      th.join();
+    }
+
+    int cnt = 0;
+    for (int k = 0; k < bound; ++k) {
+      cnt += lfsm.contains(k);
+    }
+    assert(cnt == lfsm.size());
+    std::cout << "test_concurrent_churn, size = " << lfsm.size() << ", alive values = " << CountedValue::alive << '\n';
+  }
+  assert(CountedValue::alive == 0);
+}
+
+// the remover puts then removes the victim n*span in a loop, while the inserters keep adding new keys
+// between the victim and the one before it, i.e. n*span + k for a decreasing k, which are never removed.
+// So the successor of a victim keeps changing while remove() flags it in level0, check try_flag_in_level0()
+void test_remove_with_successor_insert() {
+  constexpr int inserter_num = 3;
+  constexpr int span = 1 << 8;
+  constexpr int rounds = 1 << 17;
+  sss::LockFreeSkipMap<int, int> lfsm;
+  std::atomic<int> victim{0};
+  std::atomic<bool> done{false};
+
+  std::vector<std::thread> threads;
+  threads.push_back(std::thread([&lfsm, &victim, &done]() {
+    for (int n = 0; n < rounds; ++n) {
+      victim.store(n, std::memory_order_relaxed);
+      assert(lfsm.put_if_absent(n*span, n));
+      assert(lfsm.remove(n*span));
+    }
+    done.store(true);
+    lfsm.offline();
+  }));
+  for (int t = 0; t < inserter_num; ++t) {
+    threads.push_back(std::thread([&lfsm, &victim, &done, t]() {
+      int n = -1, k = 0;
+      while (!done.load()) {
+        const int curr = victim.load(std::memory_order_relaxed);
+        if (curr != n) {
+          n = curr;
+          k = span-1 - t;
+        }
+        if (k > 0) {
+          assert(lfsm.put_if_absent(n*span + k, k));
+          k -= inserter_num;
+        }
+      }
+      lfsm.offline();
+    }));
+  }
+  for (auto& th : threads)
+    th.join();
+
+  for (int n = 0; n < rounds; ++n)
+    assert(!lfsm.contains(n*span));
+  std::cout << "test_remove_with_successor_insert ok, size = " << lfsm.size() << '\n';
+}
+
+int main() {
+  simple_test();
+
+  test_concurrent_compute();
+
+  test_concurrent_churn<sss::NoBackoff>();
+
+  test_concurrent_churn<sss::ExponentialBackoff>();
+
+  test_remove_with_successor_insert();
+
+  return 0;
+}
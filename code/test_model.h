@@ -0,0 +1,96 @@
+// shared model check of the concurrent tests, e.g. test_lazy_skip_set.cc, test_flat_combining_skip_set.cc
+// and test_delegation_server.cc
+//
+// Each thread owns the keys of key % thread_num == t in [0, range * thread_num), so no other thread changes them,
+// and the thread knows the result of each request from its own std::set, while the keys of all threads interleave in the set.
+
+#pragma once
+
+#include <thread>
+#include <random>
+#include <vector>
+#include <set>
+#include <cassert>
+
+enum class ModelOp { kInsert, kErase, kContains };
+
+// the model of one thread
+class OwnedModel {
+public:
+  OwnedModel(const int t, const int thread_num, const int range) : g_(t), t_(t), thread_num_(thread_num), range_(range) {}
+
+  // a random owned key
+  int key() {
+    return static_cast<int>(g_() % range_) * thread_num_ + t_;
+  }
+
+  // draw a random request on an owned key, apply it to the model, and return its expected result
+  bool next(ModelOp& op, int& key) {
+    key = this->key();
+    const int action = g_() % 3;
+    if (action == 0) {
+      op = ModelOp::kInsert;
+      return keys_.insert(key).second;
+    } else if (action == 1) {
+      op = ModelOp::kErase;
+      return keys_.erase(key) == 1;
+    }
+    op = ModelOp::kContains;
+    return keys_.count(key) == 1;
+  }
+
+  const std::set<int>& keys() const { return keys_; }
+
+private:
+  std::mt19937 g_;
+  const int t_;
+  const int thread_num_;
+  const int range_;
+  std::set<int> keys_;
+};
+
+// run thread_f(model) in each thread, and return all the keys of the models after joining,
+// i.e. the keys which must be in the set
+template <class ThreadF>
+std::set<int> run_owned(const int thread_num, const int range, ThreadF thread_f) {
+  std::vector<OwnedModel> models;
+  for (int t = 0; t < thread_num; ++t)
+    models.emplace_back(t, thread_num, range);
+
+  std::vector<std::thread> threads;
+  for (auto& model : models)
+    threads.push_back(std::thread([&thread_f, &model]() { thread_f(model); }));
+  for (auto& th : threads)
+    th.join();
+
+  std::set<int> all;
+  for (const auto& model : models)
+    all.insert(model.keys().begin(), model.keys().end());
+  return all;
+}
+
+// the common case, each request is applied to the set by insert(set, key), erase(set, key) or contains(set, key)
+// and checked at once. At the end, exactly the keys of the models are in the set
+template <class Set, class Insert, class Erase, class Contains>
+std::set<int> test_owned(Set& set, const int thread_num, const int ops, const int range,
+                         Insert insert, Erase erase, Contains contains) {
+  const std::set<int> all = run_owned(thread_num, range, [&](OwnedModel& model) {
+    for (int n = 0; n < ops; ++n) {
+      ModelOp op;
+      int key;
+      const bool expected = model.next(op, key);
+      if (op == ModelOp::kInsert) {
+        assert(insert(set, key) == expected);
+      } else if (op == ModelOp::kErase) {
+        assert(erase(set, key) == expected);
+      } else {
+        assert(contains(set, key) == expected);
+      }
+    }
+  });
+
+  for (int key = 0; key < range * thread_num; ++key)
+    assert(contains(set, key) == (all.count(key) == 1));
+  assert(set.size() == static_cast<int>(all.size()));
+  return all;
+}
@@ -0,0 +1,115 @@
+#include <iostream>
+#include <random>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <cassert>
+
+#include "prefix_string.h"
+#include "lock_free_skip_set.h"
+#include "skipset.h"
+#include "skipset.cc"
+
+// count the allocations, so we can check a probe never allocates
+static std::atomic<long> g_allocations{0};
+
+void* operator new(std::size_t size) {
+  ++g_allocations;
+  if (void* p = std::malloc(size))
+    return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+  std::free(p);
+}
+
+// random strings with bytes of zero and bigger than 127, some share the first 8 bytes
+std::vector<std::string> random_strings(const int n) {
+  std::mt19937 g(2023);
+  std::vector<std::string> strs;
+  for (int i = 0; i < n; ++i) {
+    std::string s = (g() % 2 == 0) ? "same_pre" : "";
+    for (int len = g() % 20; len > 0; --len) {
+      s.push_back(static_cast<char>(g() % 4 == 0 ? 0 : g() % 256));
+    }
+    strs.push_back(s);
+  }
+  return strs;
+}
+
+// the order of PrefixString must be the same as std::string
+void test_order() {
+  const auto strs = random_strings(1 << 10);
+  for (std::size_t i = 0; i + 1 < strs.size(); ++i) {
+    const sss::PrefixString a(strs[i]);
+    const sss::PrefixString b(strs[i+1]);
+    assert((a < b) == (strs[i] < strs[i+1]));
+    assert((a == b) == (strs[i] == strs[i+1]));
+    assert((a >= b) == (strs[i] >= strs[i+1]));
+    assert((a < sss::PrefixStringView(strs[i+1])) == (strs[i] < strs[i+1]));
+    assert(a == sss::PrefixStringView(strs[i]));
+  }
+  assert(sss::PrefixString("ab") < sss::PrefixString(std::string("ab\0", 3)));
+  assert(sss::PrefixString("abcdefgh1") < sss::PrefixString("abcdefgh2"));
+  std::cout << "test_order ok\n";
+}
+
+template <class Set>
+void check_set(Set& set, const char* name) {
+  const auto strs = random_strings(1 << 12);
+  for (const auto& s : strs) {
+    set.add(s);
+  }
+
+  // iteration is in the order of std::string
+  auto sorted = strs;
+  std::sort(sorted.begin(), sorted.end());
+  sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+  std::size_t i = 0;
+  for (auto it = set.begin(); it != set.end(); ++it) {
+    assert((*it).str() == sorted[i++]);
+  }
+  assert(i == sorted.size());
+
+  // probes by std::string_view never allocate
+  const long before = g_allocations.load();
+  for (const auto& s : strs) {
+    assert(set.contains(std::string_view(s)));
+  }
+  assert(!set.contains(std::string_view("not in the set")));
+  assert(g_allocations.load() == before);
+  std::cout << "check_set for " << name << " ok\n";
+}
+
+// SkipSet has insert() instead of add()
+struct SkipSetAdapter {
+  sss::SkipSet<sss::PrefixString> set;
+
+  void add(const std::string& s) { set.insert(s); }
+  auto begin() const { return set.begin(); }
+  auto end() const { return set.end(); }
+  bool contains(const std::string_view s) const { return set.contains(s) && set.find(s) != set.end(); }
+};
+
+int main() {
+  test_order();
+
+  sss::LockFreeSkipSet<sss::PrefixString> lfss;
+  check_set(lfss, "LockFreeSkipSet");
+
+  SkipSetAdapter ss;
+  check_set(ss, "SkipSet");
+
+  return 0;
+}
@@ -0,0 +1,131 @@
+#include <iostream>
+#include <thread>
+#include <random>
+#include <vector>
+#include <set>
+#include <atomic>
+#include <cassert>
+
+#include "sharded_skip_set.h"
+
+void test_basic() {
+  std::vector<int> sample;
+  for (int i = 0; i < 1000; i += 10)
+    sample.push_back(i);
+  sss::ShardedSkipSet<int> sss(4, sample);
+
+  std::mt19937 g(2023);
+  std::set<int> expected;
+  for (int i = 0; i < 10000; ++i) {
+    const int key = g() % 2000 - 500;   // out of the sample range too
+    if (g() % 3 == 0) {
+      assert(sss.erase(key) == (expected.erase(key) == 1));
+    } else {
+      assert(sss.insert(key) == expected.insert(key).second);
+    }
+  }
+  assert(sss.size() == static_cast<int>(expected.size()));
+  for (int key = -600; key < 1600; ++key)
+    assert(sss.contains(key) == (expected.count(key) == 1));
+
+  std::vector<int> keys;
+  assert(sss.for_each([&keys](const int key) { keys.push_back(key); }) == sss.size());
+  assert(keys == std::vector<int>(expected.begin(), expected.end()));
+
+  keys.clear();
+  const int cnt = sss.scan(100, 900, [&keys](const int key) { keys.push_back(key); });
+  assert(keys == std::vector<int>(expected.lower_bound(100), expected.upper_bound(900)));
+  assert(cnt == static_cast<int>(keys.size()));
+  std::cout << "test_basic ok\n";
+}
+
+// with an empty sample, all positive keys are in the last shard, rebalance() spreads them
+void test_rebalance() {
+  constexpr int shard_num = 8;
+  constexpr int n = 1 << 16;
+  sss::ShardedSkipSet<int> sss(shard_num, {});
+  for (int i = 1; i <= n; ++i)
+    sss.insert(i);
+  assert(sss.shard_sizes().back() == n);
+
+  assert(sss.rebalance() > 0);
+  for (const int size : sss.shard_sizes())
+    assert(size > n / shard_num / 2 && size < n / shard_num * 2);
+  assert(sss.rebalance() == 0);    // balanced
+
+  int last = 0;
+  assert(sss.for_each([&last](const int key) { assert(key == last+1); last = key; }) == n);
+  for (int i = 1; i <= n; ++i)
+    assert(sss.contains(i));
+  std::cout << "test_rebalance ok, shard sizes =";
+  for (const int size : sss.shard_sizes())
+    std::cout << ' ' << size;
+  std::cout << '\n';
+}
+
+// each writer owns the keys of key % writer_num == t, so it knows the results exactly,
+// while the keys are skewed to move the range, and a thread keeps rebalancing and another keeps scanning
+void test_concurrent_rebalance() {
+  constexpr int writer_num = 4;
+  constexpr int ops = 1 << 16;
+  sss::ShardedSkipSet<int> sss(8, {0});
+
+  std::atomic<bool> stop{false};
+  std::vector<std::thread> writers;
+  std::vector<std::set<int>> owned(writer_num);
+  for (int t = 0; t < writer_num; ++t) {
+    writers.push_back(std::thread([&sss, &owned, t]() {
+      std::mt19937 g(t);
+      auto& mine = owned[t];
+      for (int n = 0; n < ops; ++n) {
+        const int base = n / 64;    // the hot range moves up over time
+        const int key = (base + static_cast<int>(g() % 1024)) * writer_num + t;
+        if (g() % 4 == 0) {
+          assert(sss.erase(key) == (mine.erase(key) == 1));
+        } else {
+          assert(sss.insert(key) == mine.insert(key).second);
+        }
+        assert(sss.contains(key) == (mine.count(key) == 1));
+      }
+    }));
+  }
+
+  int rebalanced = 0;
+  std::thread rebalancer([&sss, &stop, &rebalanced]() {
+    while (!stop.load()) {
+      rebalanced += sss.rebalance();
+      std::this_thread::yield();
+    }
+  });
+  std::thread scanner([&sss, &stop]() {
+    while (!stop.load()) {
+      int last = -1;
+      sss.for_each([&last](const int key) { assert(key > last); last = key; });
+    }
+  });
+
+  for (auto& th : writers)
+    th.join();
+  stop = true;
+  rebalancer.join();
+  scanner.join();
+
+  std::set<int> all;
+  for (const auto& mine : owned)
+    all.insert(mine.begin(), mine.end());
+  std::vector<int> keys;
+  sss.for_each([&keys](const int key) { keys.push_back(key); });
+  assert(keys == std::vector<int>(all.begin(), all.end()));
+  assert(sss.size() == static_cast<int>(all.size()));
+  std::cout << "test_concurrent_rebalance ok, size = " << sss.size() << ", splits moved = " << rebalanced << '\n';
+}
+
+int main() {
+  test_basic();
+
+  test_rebalance();
+
+  test_concurrent_rebalance();
+
+  return 0;
+}
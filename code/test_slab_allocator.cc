@@ -0,0 +1,98 @@
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <set>
+#include <algorithm>
+#include <cassert>
+
+#include "slab_allocator.h"
+#include "skipset.h"
+#include "skipset.cc"
+#include "askipset.h"
+
+struct Tower {
+  int key;
+  Tower* next[1];
+
+  static std::size_t size_of(const int height) {
+    return sizeof(Tower) + (height-1)*sizeof(Tower*);
+  }
+};
+
+// blocks of a height are cut one after another, aligned, and the freed ones are reused first
+void test_slab() {
+  sss::SlabAllocator<Tower> slab(32);
+  char* prev = nullptr;
+  for (int i = 0; i < 1000; ++i) {
+    char* const block = static_cast<char*>(slab.allocate(1));
+    assert(reinterpret_cast<uintptr_t>(block) % 16 == 0);
+    if (prev != nullptr && i != 16 && i != 48 && i != 112 && i != 240 && i != 496)
+      assert(block == prev + 16);   // adjacent in a slab, except the first block of a new slab
+    prev = block;
+  }
+
+  std::vector<void*> highs;
+  for (int i = 0; i < 100; ++i) {
+    highs.push_back(slab.allocate(20));
+    assert(reinterpret_cast<uintptr_t>(highs.back()) % 64 == 0);   // 168 bytes, in 192 bytes of block
+  }
+  const auto bytes = slab.memory_bytes();
+  assert(bytes >= 1000*16 + 100*192);
+
+  std::shuffle(highs.begin(), highs.end(), std::mt19937(2023));
+  for (void* const block : highs)
+    slab.deallocate(block, 20);
+  assert(slab.allocate(20) == highs.back());
+
+  slab.deallocate(highs.back(), 20);
+  slab.sort_free_lists();
+  std::sort(highs.begin(), highs.end());
+  for (void* const block : highs)
+    assert(slab.allocate(20) == block);
+  assert(slab.memory_bytes() == bytes);
+  std::cout << "test_slab ok, memory bytes = " << bytes << '\n';
+}
+
+// std::string keys which own heap memory, so ASan checks that each key is destroyed once
+void test_skipset_on_slab() {
+  sss::SkipSet<std::string> ss;
+  sss::ASkipSet<std::string> ass;
+  ass.set_threashold(1000, 0);
+  std::set<std::string> expected;
+  std::mt19937 g(2023);
+  for (int i = 0; i < 200000; ++i) {
+    const auto key = "a long key which is not in the small string buffer " + std::to_string(g() % 5000);
+    const int action = g() % 3;
+    if (action == 0) {
+      const bool inserted = expected.insert(key).second;
+      assert(ss.insert(key) == inserted);
+      assert(ass.insert(key) == inserted);
+    } else if (action == 1) {
+      const bool erased = expected.erase(key) == 1;
+      assert(ss.erase(key) == erased);
+      assert(ass.erase(key) == erased);
+    } else {
+      assert(ss.contains(key) == (expected.count(key) == 1));
+      assert(ass.contains(key) == (expected.count(key) == 1));
+    }
+  }
+
+  assert(ss.size() == static_cast<int>(expected.size()));
+  std::vector<std::string> keys, akeys;
+  for (auto it = ss.begin(); it != ss.end(); ++it)
+    keys.push_back(*it);
+  for (auto it = ass.begin(); it != ass.end(); ++it)
+    akeys.push_back(*it);
+  assert(keys == std::vector<std::string>(expected.begin(), expected.end()));
+  assert(akeys == keys);
+  std::cout << "test_skipset_on_slab ok, size = " << ss.size() << '\n';
+}
+
+int main() {
+  test_slab();
+
+  test_skipset_on_slab();
+
+  return 0;
+}
@@ -0,0 +1,60 @@
+// stress harness for the lock-free containers under heavy interleaving
+// build it both with and without -DSSS_TUNED_MEMORY_ORDER, check memory_order.h
+//
+// The invariants are checked by test_stress.h, and the iteration of the skip set must be strictly ordered too
+
+#include <iostream>
+#include <vector>
+#include <cassert>
+
+#include "lock_free_skip_set.h"
+#include "lock_free_set_link_list.h"
+#include "test_stress.h"
+
+template <class Set = sss::LockFreeSkipSet<int>>
+void test_stress_lfss(const int thread_num, const int ops) {
+  Set lfss;
+  Counters counters;
+  std::vector<std::vector<bool>> owned(thread_num, std::vector<bool>(kOwnedKeys, false));
+  run_stress(lfss, thread_num, ops, counters, owned);
+
+  const int size = check_and_count(lfss, counters, owned);
+
+  int cnt = 0;
+  int last = -1;
+  for (auto it = lfss.begin(); it != lfss.end(); ++it) {
+    assert(*it > last);
+    last = *it;
+    ++cnt;
+  }
+  assert(cnt == size);
+  std::cout << "test_stress_lfss, thread nums = " << thread_num << ", size = " << size << '\n';
+}
+
+template <class Set = sss::LockFreeSetLinkList<int>>
+void test_stress_lfsll(const int thread_num, const int ops) {
+  Set lfsll;
+  Counters counters;
+  std::vector<std::vector<bool>> owned(thread_num, std::vector<bool>(kOwnedKeys, false));
+  run_stress(lfsll, thread_num, ops, counters, owned);
+
+  const int size = check_and_count(lfsll, counters, owned);
+  std::cout << "test_stress_lfsll, thread nums = " << thread_num << ", size = " << size << '\n';
+}
+
+int main() {
+  std::cout << "tuned memory order = " << (sss::kTunedMemoryOrder ? "true" : "false") << '\n';
+
+  for (const int thread_num : {2, 4, 8, 16}) {
+    test_stress_lfss(thread_num, 1 << 17);
+    test_stress_lfsll(thread_num, 1 << 17);
+  }
+
+  // the contention managers only change the timing of retries, so the invariants must hold too
+  test_stress_lfss<sss::LockFreeSkipSet<int, sss::EpochReclaimer, sss::ExponentialBackoff>>(8, 1 << 17);
+  test_stress_lfsll<sss::LockFreeSetLinkList<int, sss::HazardPointerDomain, sss::ExponentialBackoff>>(8, 1 << 17);
+  test_stress_lfss<sss::LockFreeSkipSet<int, sss::EpochReclaimer, sss::PauseSpin>>(8, 1 << 17);
+  test_stress_lfsll<sss::LockFreeSetLinkList<int, sss::HazardPointerDomain, sss::PauseSpin>>(8, 1 << 17);
+
+  return 0;
+}
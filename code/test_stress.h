@@ -0,0 +1,108 @@
+// shared stress harness of the concurrent sets, e.g. test_stress.cc and test_lazy_skip_set.cc
+//
+// Each thread runs a random mix of add(), remove() and contains() on a small key range,
+// so nearly every operation races with others on the same nodes.
+// The following invariants are checked:
+// 1. for a key only owned by the thread, every result matches the thread's own model,
+//    i.e. no other thread can change it, so the set must behave like a sequential one
+// 2. for the shared keys, successful add() and remove() of each key alternate,
+//    so at the end, (adds - removes) of each key is 0 or 1 and equals contains()
+// 3. at the end, size() is the sum of 2 and the owned keys
+//
+// The set only needs add(), remove(), contains() and size(), quiescent() and offline() are called if it has them
+
+#pragma once
+
+#include <thread>
+#include <random>
+#include <vector>
+#include <atomic>
+#include <functional>
+#include <cassert>
+
+#include "test_churn.h"
+
+constexpr int kSharedKeys = 32;
+
+struct Counters {
+  std::vector<std::atomic<int>> adds;
+  std::vector<std::atomic<int>> removes;
+
+  Counters() : adds(kSharedKeys), removes(kSharedKeys) {}
+};
+
+// keys in [0, kSharedKeys) are shared by all threads,
+// keys of kSharedKeys + tid * kOwnedKeys + [0, kOwnedKeys) are only owned by the thread tid
+constexpr int kOwnedKeys = 16;
+
+template <class Set>
+void stress_f(const int tid, const int ops, Set& set, Counters& counters, std::vector<bool>& owned) {
+  std::mt19937 g(tid);
+  const int owned_base = kSharedKeys + tid * kOwnedKeys;
+
+  for (int i = 0; i < ops; ++i) {
+    const int action = g() % 3;
+    if (g() % 2 == 0) {
+      const int key = g() % kSharedKeys;
+      if (action == 0) {
+        if (set.add(key))
+          ++counters.adds[key];
+      } else if (action == 1) {
+        if (set.remove(key))
+          ++counters.removes[key];
+      } else {
+        set.contains(key);
+      }
+
+    } else {
+      const int idx = g() % kOwnedKeys;
+      const int key = owned_base + idx;
+      if (action == 0) {
+        const bool added = set.add(key);
+        assert(added == !owned[idx]);
+        owned[idx] = true;
+      } else if (action == 1) {
+        const bool removed = set.remove(key);
+        assert(removed == owned[idx]);
+        owned[idx] = false;
+      } else {
+        assert(set.contains(key) == owned[idx]);
+      }
+    }
+
+    if (i % 64 == 0)
+      quiescent(set);
+  }
+  offline(set);
+}
+
+template <class Set>
+int check_and_count(Set& set, const Counters& counters, const std::vector<std::vector<bool>>& owned) {
+  int expected_size = 0;
+  for (int key = 0; key < kSharedKeys; ++key) {
+    const int net = counters.adds[key] - counters.removes[key];
+    assert(net == 0 || net == 1);
+    assert(set.contains(key) == (net == 1));
+    expected_size += net;
+  }
+  for (int tid = 0, n = owned.size(); tid < n; ++tid) {
+    for (int idx = 0; idx < kOwnedKeys; ++idx) {
+      assert(set.contains(kSharedKeys + tid * kOwnedKeys + idx) == owned[tid][idx]);
+      expected_size += owned[tid][idx];
+    }
+  }
+  assert(set.size() == expected_size);
+  return expected_size;
+}
+
+template <class Set>
+void run_stress(Set& set, const int thread_num, const int ops, Counters& counters,
+                std::vector<std::vector<bool>>& owned) {
+  std::vector<std::thread> threads;
+  for (int i = 0; i < thread_num; ++i) {
+    threads.push_back(std::thread(stress_f<Set>, i, ops, std::ref(set), std::ref(counters), std::ref(owned[i])));
+  }
+  for (auto& th : threads) {
+    th.join();
+  }
+}
@@ -0,0 +1,106 @@
+#include <iostream>
+#include <thread>
+#include <random>
+#include <vector>
+#include <set>
+#include <cassert>
+
+#include "swmr_skip_set.h"
+
+void test_basic() {
+  sss::SwmrSkipSet<int> swmr;
+  assert(swmr.empty());
+  std::mt19937 g(2023);
+  std::set<int> expected;
+  for (int i = 0; i < 100000; ++i) {
+    const int key = g() % 1000;
+    const int action = g() % 4;
+    if (action == 0) {
+      assert(swmr.insert(key) == expected.insert(key).second);
+    } else if (action == 1) {
+      assert(swmr.erase(key) == (expected.erase(key) == 1));
+    } else if (action == 2) {
+      assert(swmr.contains(key) == (expected.count(key) == 1));
+    } else {
+      int result = -1;
+      const auto it = expected.lower_bound(key);
+      assert(swmr.lower_bound(key, result) == (it != expected.end()));
+      assert(it == expected.end() || result == *it);
+    }
+  }
+  assert(swmr.size() == static_cast<int>(expected.size()));
+
+  std::vector<int> keys;
+  swmr.for_each([&keys](const int key) { keys.push_back(key); });
+  assert(keys == std::vector<int>(expected.begin(), expected.end()));
+
+  for (const int key : keys)
+    assert(swmr.erase(key));
+  assert(swmr.empty());
+  assert(!swmr.contains(keys.front()));
+  std::cout << "test_basic ok\n";
+}
+
+// the even keys are always in the set, and the writer churns the odd keys.
+// The readers must always find the even keys, never find a key out of the range, and see the keys in order
+void test_concurrent() {
+  constexpr int reader_num = 8;
+  constexpr int bound = 1 << 12;
+  constexpr int writes = 1 << 18;
+  sss::SwmrSkipSet<int> swmr;
+  for (int key = 0; key < bound; key += 2)
+    swmr.insert(key);
+
+  std::atomic<bool> stop{false};
+  std::vector<std::thread> readers;
+  for (int t = 0; t < reader_num; ++t) {
+    readers.push_back(std::thread([&swmr, &stop, t]() {
+      std::mt19937 g(t);
+      int rounds = 0;
+      while (!stop.load(std::memory_order_relaxed)) {
+        const int key = g() % (bound-1);   // the odd keys have the even key+1 in the set
+        if (key % 2 == 0) {
+          assert(swmr.contains(key));
+        } else {
+          int result = -1;
+          assert(swmr.lower_bound(key, result));
+          assert(result == key || result == key+1);
+        }
+        assert(!swmr.contains(bound + key));
+
+        if (++rounds % 256 == 0) {
+          int prev = -1, evens = 0;
+          swmr.for_each([&prev, &evens](const int k) { assert(k > prev); prev = k; evens += k % 2 == 0; });
+          assert(evens == bound/2);
+        }
+      }
+    }));
+  }
+
+  std::mt19937 g(2023);
+  std::set<int> odds;
+  for (int i = 0; i < writes; ++i) {
+    const int key = (g() % (bound/2)) * 2 + 1;
+    if (g() % 2 == 0) {
+      assert(swmr.insert(key) == odds.insert(key).second);
+    } else {
+      assert(swmr.erase(key) == (odds.erase(key) == 1));
+    }
+  }
+  stop.store(true);
+  for (auto& th : readers)
+    th.join();
+
+  assert(swmr.size() == bound/2 + static_cast<int>(odds.size()));
+  for (int key = 1; key < bound; key += 2)
+    assert(swmr.contains(key) == (odds.count(key) == 1));
+  std::cout << "test_concurrent ok, size = " << swmr.size() << '\n';
+}
+
+int main() {
+  test_basic();
+
+  test_concurrent();
+
+  return 0;
+}
@@ -0,0 +1,71 @@
+// per-thread random generator for the concurrent containers
+//
+// rand() shares one state for all threads, glibc guards it with a lock,
+// so threads which add() concurrently serialize on it. And srand() reseeds the global state for the whole process.
+// Here each thread has its own state of xorshift64*, so next() only touches thread local data.
+//
+// A thread seeds its own generator with seed(), e.g. for a reproducible benchmark.
+// Otherwise, the generator is seeded by splitmix64 from a global counter when the thread uses it for the first time,
+// so different threads get different streams.
+// reference: Sebastiano Vigna, <<An experimental exploration of Marsaglia's xorshift generators, scrambled>>
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cassert>
+
+namespace sss {
+
+class ThreadRandom {
+public:
+  // seed the generator of the calling thread
+  static void seed(const uint64_t seed) noexcept {
+    uint64_t s = seed;
+    state() = splitmix64(s);
+  }
+
+  static uint64_t next() noexcept {
+    uint64_t& x = state();
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    return x * 0x2545F4914F6CDD1DULL;
+  }
+
+  // random height in [1, max_height] with probability 0.5 for each level up, i.e. P(height >= h) = 1/2^(h-1).
+  // One random word is enough, because each bit is a coin flip, and the trailing zeros are the number of heads.
+  // NOTE: the bit of max_height-1 is set, so the result never exceeds max_height
+  static int geometric_height(const int max_height) noexcept {
+    assert(max_height > 0 && max_height <= 64);
+    const uint64_t bits = next() | (uint64_t(1) << (max_height-1));
+    return __builtin_ctzll(bits) + 1;
+  }
+
+  // random in [0, 1)
+  static double uniform() noexcept {
+    return (next() >> 11) * (1.0 / (uint64_t(1) << 53));
+  }
+
+private:
+  static uint64_t splitmix64(uint64_t& x) noexcept {
+    uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z = z ^ (z >> 31);
+    return z != 0 ? z : 1;    // xorshift can not have a zero state
+  }
+
+  static uint64_t& state() noexcept {
+    thread_local uint64_t s = first_seed();
+    return s;
+  }
+
+  static uint64_t first_seed() noexcept {
+    static std::atomic<uint64_t> counter{0};
+    uint64_t s = counter.fetch_add(1, std::memory_order_relaxed);
+    return splitmix64(s);
+  }
+};
+
+} // namespace sss
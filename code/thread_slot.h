@@ -0,0 +1,69 @@
+// thread slot is a small dense index for each live thread,
+// so per-thread data of the lock-free containers (epoch records, retire lists, ...)
+// can live in a plain array owned by the container instead of thread_local storage
+
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <iostream>
+
+namespace sss {
+
+class ThreadSlot {
+public:
+  static constexpr int kMaxThreads = 256;
+
+  // the slot id of the calling thread in [0, kMaxThreads)
+  // the first call from a thread claims a free slot, the slot is released when the thread exits
+  static int id() noexcept {
+    thread_local Holder holder;
+    return holder.id;
+  }
+
+  // all claimed slot ids are less than high_water(), so scanning [0, high_water()) is enough
+  static int high_water() noexcept {
+    return high_water_.load(std::memory_order_acquire);
+  }
+
+  // increased each time the slot is released.
+  // It helps a container to know that the thread which owned the slot has exited.
+  static unsigned generation(const int id) noexcept {
+    assert(id >= 0 && id < kMaxThreads);
+    return generations_[id].load(std::memory_order_acquire);
+  }
+
+private:
+  struct Holder {
+    int id;
+
+    Holder() : id(claim()) {}
+    ~Holder() noexcept { release(id); }
+  };
+
+  static int claim() noexcept {
+    for (int i = 0; i < kMaxThreads; ++i) {
+      bool expected = false;
+      if (!used_[i].load(std::memory_order_relaxed) &&
+          used_[i].compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+        int hw = high_water_.load(std::memory_order_relaxed);
+        while (hw < i+1 && !high_water_.compare_exchange_weak(hw, i+1, std::memory_order_acq_rel)) {}
+        return i;
+      }
+    }
+
+    std::cerr << "too many live threads for ThreadSlot, max = " << kMaxThreads << '\n';
+    exit(-1);
+  }
+
+  static void release(const int id) noexcept {
+    generations_[id].fetch_add(1, std::memory_order_acq_rel);
+    used_[id].store(false, std::memory_order_release);
+  }
+
+  static inline std::atomic<bool> used_[kMaxThreads] = {};
+  static inline std::atomic<unsigned> generations_[kMaxThreads] = {};
+  static inline std::atomic<int> high_water_{0};
+};
+
+} // namespace sss
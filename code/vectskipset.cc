@@ -1,5 +1,9 @@
 #include <vector>
 #include <iostream>
+#include <tuple>
+#include <algorithm>
+#include <cstring>
+#include <cassert>
 
 #include "vectskipset.h"
 
@@ -281,6 +285,9 @@ void VectSkipSet<T>::delete_node(Node* preds[], Node* to_delete) {
   }
   while (level_ > 0 && head_->next[level_] == nullptr)
     --level_;
+
+  to_delete->keys.clear();
+  destroy_node(to_delete);
 }
 
 // guarantee the key is distinct and less than the min key of the node
@@ -0,0 +1,57 @@
+// write counters of LockFreeSkipSet for ScanMode::kPointInTime, i.e. the seqlock of the point-in-time scan
+//
+// It is a template parameter of LockFreeSkipSet like the Reclaimer, Backoff and Index
+// 1. NoWriteCounter (default), add() and remove() pay nothing, and only ScanMode::kWeak is supported
+// 2. WriteCounter, every add() which links level0 and every remove() which flags level0 are between begin() and end(),
+//    which are two RMWs on striped counters (one of them seq_cst), so a point-in-time scan can validate
+//    that no writer changed the set during it. Check LockFreeSkipSet::snapshot()
+//
+// NOTE: the counters are not folded, so each stripe only increases and two equal sums mean no stripe changed,
+//       check StripedCounter
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "striped_counter.h"
+
+namespace sss {
+
+class NoWriteCounter {
+public:
+  static constexpr bool kEnabled = false;
+
+  void begin() noexcept {}
+  void end() noexcept {}
+  int64_t started() const noexcept { return 0; }
+  int64_t finished() const noexcept { return 0; }
+};
+
+class WriteCounter {
+public:
+  static constexpr bool kEnabled = true;
+
+  // seq_cst, so the scan which sees the CAS of the writer in the links sees begin() too
+  void begin() noexcept {
+    started_.add(1, std::memory_order_seq_cst);
+  }
+
+  void end() noexcept {
+    finished_.add(1, std::memory_order_release);
+  }
+
+  int64_t started() const noexcept {
+    return started_.sum(std::memory_order_acquire);
+  }
+
+  int64_t finished() const noexcept {
+    return finished_.sum(std::memory_order_acquire);
+  }
+
+private:
+  StripedCounter started_;
+  StripedCounter finished_;
+};
+
+} // namespace sss